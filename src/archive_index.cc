@@ -0,0 +1,342 @@
+#include "archive_index.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+#include <utility>
+
+#include "crc.hh"
+
+namespace {
+
+// Start of a saved index; the columns follow, those of size_t first so that all stay aligned and
+// can be read in place.
+struct SavedIndex {
+  char     magic[4];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t word_size;
+  uint64_t archive_size;
+  int64_t  archive_mtime;
+  uint32_t header_hash;
+  uint32_t reserved;
+  uint64_t entries;
+  uint64_t blocks;
+};
+
+constexpr char     kMagic[4]  = {'L', 'Z', 'X', 'I'};
+constexpr uint32_t kVersion   = 2;
+constexpr uint32_t kByteOrder = 0x01020304;
+
+// Headers hashed by `ArchiveIndex::header_hash()`.
+constexpr size_t kHashSamples = 64;
+
+static_assert(sizeof(SavedIndex) % alignof(size_t) == 0);
+static_assert(alignof(size_t) % alignof(uint32_t) == 0);
+
+template <typename Column>
+bool write_column(std::ofstream& file, const Column& column) {
+  return static_cast<bool>(file.write(reinterpret_cast<const char*>(column.data()),
+      static_cast<std::streamsize>(column.size() * sizeof(column[0]))));
+}
+
+template <typename T>
+Status read_column(InputBuffer& buffer, std::span<const T>& column, uint64_t size) {
+  std::span<const uint8_t> section;
+  if (buffer.available() / sizeof(T) < size) return Status::StaleIndex;
+  TRY(buffer.read_span(size * sizeof(T), section));
+  column = {reinterpret_cast<const T*>(section.data()), static_cast<size_t>(size)};
+  return Status::Ok;
+}
+
+}  // namespace
+
+ArchiveIndex::ArchiveIndex(InputBuffer buffer, std::shared_ptr<BlockCache> cache)
+    : buffer_(buffer), cache_(std::move(cache)) {
+  InputBuffer all = buffer_;
+  all.read_span(all.available(), data_);
+}
+
+void ArchiveIndex::use_columns() {
+  header_offsets_     = columns_.header_offsets;
+  entry_blocks_       = columns_.entry_blocks;
+  entry_offsets_      = columns_.entry_offsets;
+  by_name_            = columns_.by_name;
+  block_headers_      = columns_.block_headers;
+  block_data_offsets_ = columns_.block_data_offsets;
+  block_unpack_sizes_ = columns_.block_unpack_sizes;
+}
+
+Status ArchiveIndex::stamp_of(const std::filesystem::path& archive, Stamp& out) {
+  std::error_code error;
+  auto            size = std::filesystem::file_size(archive, error);
+  if (error) return Status::FileOpenError;
+  auto mtime = std::filesystem::last_write_time(archive, error);
+  if (error) return Status::FileOpenError;
+
+  out = {size, static_cast<int64_t>(mtime.time_since_epoch().count())};
+  return Status::Ok;
+}
+
+Status ArchiveIndex::from_buffer(
+    InputBuffer buffer, std::unique_ptr<ArchiveIndex>& out, std::shared_ptr<BlockCache> cache) {
+  out.reset(new ArchiveIndex(buffer, std::move(cache)));
+  auto& index   = *out;
+  auto& columns = index.columns_;
+
+  // Merged entries wait for the header that carries their group's packed data.
+  std::vector<uint32_t> pending;
+  size_t                merged_size = 0;
+  Status                status      = Status::Ok;
+
+  lzx::HeaderIterator headers(buffer);
+  lzx::HeaderView     view;
+  while (!headers.at_end()) {
+    size_t position = headers.position();
+    status          = headers.next(view);
+    if (status != Status::Ok) break;
+    const auto& header = *view.header;
+
+    auto entry = static_cast<uint32_t>(columns.header_offsets.size());
+    columns.header_offsets.push_back(position);
+    columns.entry_blocks.push_back(kNoBlock);
+    columns.entry_offsets.push_back(0);
+
+    bool   merged     = header.flags().is_merged();
+    size_t block_size = header.unpack_size();
+    if (merged) {
+      pending.push_back(entry);
+      columns.entry_offsets.back() = merged_size;
+      merged_size += header.unpack_size();
+      block_size = merged_size;
+    }
+    if (merged && header.pack_size() == 0) continue;
+
+    auto block = static_cast<uint32_t>(columns.block_headers.size());
+    columns.block_headers.push_back(entry);
+    columns.block_data_offsets.push_back(static_cast<size_t>(view.packed.data() - index.data_.data()));
+    columns.block_unpack_sizes.push_back(block_size);
+    if (!merged) {
+      columns.entry_blocks[entry] = block;
+      continue;
+    }
+    for (uint32_t member : pending) columns.entry_blocks[member] = block;
+    pending.clear();
+    merged_size = 0;
+  }
+
+  index.blocks_.resize(columns.block_headers.size());
+  columns.by_name.resize(columns.header_offsets.size());
+  for (uint32_t entry = 0; entry < columns.by_name.size(); ++entry) columns.by_name[entry] = entry;
+  index.use_columns();
+  std::stable_sort(columns.by_name.begin(), columns.by_name.end(),
+      [&index](uint32_t left, uint32_t right) { return index.name(left) < index.name(right); });
+
+  return status;
+}
+
+// The text is cut at the end of the archive: a loaded index has not read every header.
+std::string_view ArchiveIndex::name(size_t entry) const {
+  size_t      offset = header_offsets_[entry] + sizeof(lzx::Header);
+  const auto* start  = reinterpret_cast<const char*>(data_.data() + offset);
+  return std::string_view(start, std::min<size_t>(header(entry).filename_length(), data_.size() - offset));
+}
+
+std::string_view ArchiveIndex::comment(size_t entry) const {
+  auto   name   = this->name(entry);
+  size_t offset = header_offsets_[entry] + sizeof(lzx::Header) + name.size();
+  return std::string_view(
+      name.data() + name.size(), std::min<size_t>(header(entry).comment_length(), data_.size() - offset));
+}
+
+size_t ArchiveIndex::pack_size(size_t entry) const {
+  const auto& header = this->header(entry);
+  if (!header.flags().is_merged()) return header.pack_size();
+
+  uint32_t block = entry_blocks_[entry];
+  if (block == kNoBlock || block_unpack_sizes_[block] == 0) return 0;
+  uint64_t packed = this->header(block_headers_[block]).pack_size();
+  return static_cast<size_t>(header.unpack_size() * packed / block_unpack_sizes_[block]);
+}
+
+std::optional<size_t> ArchiveIndex::find(std::string_view name) const {
+  auto found = std::lower_bound(by_name_.begin(), by_name_.end(), name,
+      [this](uint32_t entry, std::string_view name) { return this->name(entry) < name; });
+  if (found == by_name_.end() || this->name(*found) != name) return std::nullopt;
+  return *found;
+}
+
+std::shared_ptr<LzxBlock> ArchiveIndex::block(size_t block) {
+  if (blocks_[block]) return blocks_[block];
+
+  std::unique_ptr<lzx::Entry> header;
+  InputBuffer                 header_buffer = buffer_;
+  if (header_buffer.skip(header_offsets_[block_headers_[block]]) != Status::Ok) return nullptr;
+  if (lzx::Entry::from_buffer(&header_buffer, header) != Status::Ok || !header) return nullptr;
+
+  // The carrying header ends the block; a saved index has only been checked against a sample.
+  size_t carrier = block_headers_[block];
+  if (entry_offsets_[carrier] + header->unpack_size() != block_unpack_sizes_[block]) return nullptr;
+
+  InputBuffer data_buffer = buffer_;
+  InputBuffer packed;
+  if (data_buffer.skip(block_data_offsets_[block]) != Status::Ok) return nullptr;
+  if (data_buffer.read_buffer(header->pack_size(), packed) != Status::Ok) return nullptr;
+
+  blocks_[block] = std::make_shared<LzxBlock>(
+      std::move(*header), packed, block_unpack_sizes_[block], block, cache_);
+  return blocks_[block];
+}
+
+std::optional<LzxEntry> ArchiveIndex::entry(size_t entry) {
+  // Validated while indexing, but a loaded index has only checked a sample of the headers.
+  std::unique_ptr<lzx::Entry> metadata;
+  InputBuffer                 header_buffer = buffer_;
+  if (header_buffer.skip(header_offsets_[entry]) != Status::Ok) return std::nullopt;
+  if (lzx::Entry::from_buffer(&header_buffer, metadata) != Status::Ok || !metadata) {
+    return std::nullopt;
+  }
+
+  std::vector<LzxFileSegment> segments;
+  if (entry_blocks_[entry] != kNoBlock) {
+    auto   block = this->block(entry_blocks_[entry]);
+    size_t size  = header(entry).unpack_size();
+    if (block && size <= block_unpack_sizes_[entry_blocks_[entry]] - entry_offsets_[entry]) {
+      segments.emplace_back(std::move(block), entry_offsets_[entry], size);
+    }
+  }
+  return LzxEntry(std::string(name(entry)), std::move(*metadata), std::move(segments));
+}
+
+// Only the columns are read, not the headers they point at; those are checked as entries and
+// blocks are created.
+bool ArchiveIndex::columns_valid() const {
+  size_t entries = header_offsets_.size();
+  size_t blocks  = block_headers_.size();
+  if (data_.size() < sizeof(lzx::Header) && entries > 0) return false;
+
+  // Headers are in archive order, and each has room for its fixed part.
+  std::vector<size_t> members(blocks);
+  for (size_t entry = 0; entry < entries; ++entry) {
+    size_t offset = header_offsets_[entry];
+    if (offset > data_.size() - sizeof(lzx::Header)) return false;
+    if (entry > 0 && offset < header_offsets_[entry - 1] + sizeof(lzx::Header)) return false;
+    if (by_name_[entry] >= entries) return false;
+
+    uint32_t block = entry_blocks_[entry];
+    if (block == kNoBlock) continue;
+    if (block >= blocks || entry_offsets_[entry] > block_unpack_sizes_[block]) return false;
+    ++members[block];
+  }
+
+  // Packed data follows the header that carries its size, and no entry holds more than 4 GiB.
+  for (size_t block = 0; block < blocks; ++block) {
+    uint32_t carrier = block_headers_[block];
+    if (carrier >= entries || entry_blocks_[carrier] != block) return false;
+    size_t data_offset = block_data_offsets_[block];
+    if (data_offset < header_offsets_[carrier] + sizeof(lzx::Header) || data_offset > data_.size()) {
+      return false;
+    }
+    if (block_unpack_sizes_[block] / ~uint32_t{0} > members[block]) return false;
+  }
+  return true;
+}
+
+// The first and last headers and evenly spaced ones between them: enough to catch an archive
+// rewritten with the same stamp, while loading stays independent of the number of entries.
+std::optional<uint32_t> ArchiveIndex::header_hash() const {
+  size_t     count   = header_offsets_.size();
+  size_t     samples = std::min(count, kHashSamples);
+  crc::Crc32 crc;
+  for (size_t sample = 0; sample < samples; ++sample) {
+    size_t offset = header_offsets_[samples == 1 ? 0 : sample * (count - 1) / (samples - 1)];
+    if (offset > data_.size() || data_.size() - offset < sizeof(lzx::Header)) return std::nullopt;
+    const auto& header = *reinterpret_cast<const lzx::Header*>(data_.data() + offset);
+    size_t      text   = size_t{header.filename_length()} + header.comment_length();
+    if (data_.size() - offset - sizeof(lzx::Header) < text) return std::nullopt;
+    crc.calc(&header, sizeof(header));
+  }
+  return crc.sum();
+}
+
+Status ArchiveIndex::save(const std::filesystem::path& path, const Stamp& stamp) const {
+  auto hash = header_hash();
+  if (!hash) return Status::OutOfRange;
+
+  SavedIndex saved{};
+  std::copy(std::begin(kMagic), std::end(kMagic), saved.magic);
+  saved.version       = kVersion;
+  saved.byte_order    = kByteOrder;
+  saved.word_size     = sizeof(size_t);
+  saved.archive_size  = stamp.size;
+  saved.archive_mtime = stamp.mtime;
+  saved.header_hash   = *hash;
+  saved.entries       = header_offsets_.size();
+  saved.blocks        = block_headers_.size();
+
+  auto temporary = path;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file) return Status::FileCreateError;
+    bool written = file.write(reinterpret_cast<const char*>(&saved), sizeof(saved)) &&
+                   write_column(file, header_offsets_) && write_column(file, entry_offsets_) &&
+                   write_column(file, block_data_offsets_) &&
+                   write_column(file, block_unpack_sizes_) && write_column(file, entry_blocks_) &&
+                   write_column(file, by_name_) && write_column(file, block_headers_) &&
+                   file.flush();
+    if (!written) {
+      file.close();
+      std::error_code ignored;
+      std::filesystem::remove(temporary, ignored);
+      return Status::FileWriteError;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+    return Status::FileWriteError;
+  }
+  return Status::Ok;
+}
+
+Status ArchiveIndex::load(InputBuffer buffer, const std::filesystem::path& path, const Stamp& stamp,
+    std::unique_ptr<ArchiveIndex>& out, std::shared_ptr<BlockCache> cache) {
+  std::unique_ptr<MmapInputBuffer> mapping;
+  TRY(MmapInputBuffer::for_file(path.string().c_str(), mapping));
+  InputBuffer saved_buffer = mapping->get();
+
+  SavedIndex saved;
+  if (saved_buffer.read_into(&saved, sizeof(saved)) != Status::Ok) return Status::StaleIndex;
+  if (!std::equal(std::begin(kMagic), std::end(kMagic), saved.magic) ||
+      saved.version != kVersion || saved.byte_order != kByteOrder ||
+      saved.word_size != sizeof(size_t)) {
+    return Status::StaleIndex;
+  }
+  if (saved.archive_size != stamp.size || saved.archive_mtime != stamp.mtime) {
+    return Status::StaleIndex;
+  }
+
+  std::unique_ptr<ArchiveIndex> index(new ArchiveIndex(buffer, std::move(cache)));
+  TRY(read_column(saved_buffer, index->header_offsets_, saved.entries));
+  TRY(read_column(saved_buffer, index->entry_offsets_, saved.entries));
+  TRY(read_column(saved_buffer, index->block_data_offsets_, saved.blocks));
+  TRY(read_column(saved_buffer, index->block_unpack_sizes_, saved.blocks));
+  TRY(read_column(saved_buffer, index->entry_blocks_, saved.entries));
+  TRY(read_column(saved_buffer, index->by_name_, saved.entries));
+  TRY(read_column(saved_buffer, index->block_headers_, saved.blocks));
+  if (!saved_buffer.is_eof()) return Status::StaleIndex;
+  index->saved_ = std::move(mapping);
+
+  if (!index->columns_valid() || index->header_hash() != saved.header_hash) {
+    return Status::StaleIndex;
+  }
+
+  index->blocks_.resize(index->block_headers_.size());
+  out = std::move(index);
+  return Status::Ok;
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "block_cache.hh"
+#include "error.hh"
+#include "lzx_block.hh"
+#include "lzx_entry.hh"
+#include "lzx_handle.hh"
+#include "mmap_buffer.hh"
+
+/**
+ * @brief Compact, read-only listing of an archive, for archives with very many entries.
+ *
+ * Unlike `Unlzx::list_archive()`, which copies every header into its entry and block, the index
+ * keeps flat per-entry and per-block columns of offsets into the archive. Headers, names and
+ * comments are read in place from the mapping, which must outlive the index. Entries keep their
+ * archive order; a name-sorted permutation serves lookups. Blocks and LzxEntry objects are only
+ * created for the entries asked for.
+ *
+ * An index can be saved next to its archive and loaded on a later open in place of the header
+ * scan; see `save()` and `load()`. A loaded index reads its columns in place from the saved file.
+ */
+class ArchiveIndex {
+ public:
+  /// Block of an entry whose merged group has no data, i.e. the archive is truncated.
+  static constexpr uint32_t kNoBlock = ~uint32_t{0};
+
+  /**
+   * @brief Identifies the version of an archive file a saved index was built from.
+   */
+  struct Stamp {
+    uint64_t size  = 0;  ///< Size of the archive file in bytes.
+    int64_t  mtime = 0;  ///< Last write time of the archive file, in file clock ticks.
+
+    bool operator==(const Stamp&) const = default;
+  };
+
+  /**
+   * @brief Gets the stamp of an archive file.
+   * @param archive The path to the archive file.
+   * @param out The stamp.
+   * @return Status::Ok, or Status::FileOpenError if the file cannot be examined.
+   */
+  static Status stamp_of(const std::filesystem::path& archive, Stamp& out);
+
+  /**
+   * @brief Indexes the entries of an archive.
+   *
+   * The index is built even if reading stops early, and holds the entries read until then.
+   *
+   * @param buffer The archive contents following the archive header.
+   * @param out The index.
+   * @param cache The cache for the blocks created by `block()`, or nullptr for none.
+   * @return Status::Ok if every header was read, otherwise the error that ended the listing early.
+   */
+  static Status from_buffer(InputBuffer buffer, std::unique_ptr<ArchiveIndex>& out,
+      std::shared_ptr<BlockCache> cache = nullptr);
+
+  /**
+   * @brief Loads an index saved by `save()`, without reading the archive headers.
+   *
+   * The saved index is used only if it was saved for an archive with the same stamp, and its
+   * hash of a sample of the headers, the first and the last among them, matches the archive. The
+   * other headers are not read, so loading takes about the same time for any archive size.
+   *
+   * @param buffer The archive contents following the archive header.
+   * @param path The path to the saved index.
+   * @param stamp The stamp of the archive file.
+   * @param out The index.
+   * @param cache The cache for the blocks created by `block()`, or nullptr for none.
+   * @return Status::Ok, Status::FileOpenError if there is no saved index, or Status::StaleIndex
+   *         if it was saved for another archive or is damaged.
+   */
+  static Status load(InputBuffer buffer, const std::filesystem::path& path, const Stamp& stamp,
+      std::unique_ptr<ArchiveIndex>& out, std::shared_ptr<BlockCache> cache = nullptr);
+
+  /**
+   * @brief Saves the index for `load()`.
+   *
+   * The index is written next to its final path and renamed into place, so a concurrent `load()`
+   * never sees a partial file. The file is meant for this machine only: it uses the native byte
+   * order and word size.
+   *
+   * @param path The path to save to.
+   * @param stamp The stamp of the archive file.
+   * @return Status::Ok, or the error writing the file.
+   */
+  Status save(const std::filesystem::path& path, const Stamp& stamp) const;
+
+  /**
+   * @brief Gets the number of entries.
+   * @return The number of headers read, including repeated names.
+   */
+  size_t size() const { return header_offsets_.size(); }
+
+  /**
+   * @brief Gets the number of blocks.
+   * @return The number of blocks of packed data.
+   */
+  size_t block_count() const { return block_headers_.size(); }
+
+  /**
+   * @brief Gets the header of an entry.
+   * @param entry The entry, in archive order.
+   * @return The header, read in place.
+   */
+  const lzx::Header& header(size_t entry) const {
+    return *reinterpret_cast<const lzx::Header*>(data_.data() + header_offsets_[entry]);
+  }
+
+  /**
+   * @brief Gets the name of an entry.
+   * @param entry The entry, in archive order.
+   * @return The name, as stored in the archive.
+   */
+  std::string_view name(size_t entry) const;
+
+  /**
+   * @brief Gets the comment of an entry.
+   * @param entry The entry, in archive order.
+   * @return The comment, as stored in the archive.
+   */
+  std::string_view comment(size_t entry) const;
+
+  /**
+   * @brief Gets the block holding the data of an entry.
+   * @param entry The entry, in archive order.
+   * @return The block index, or kNoBlock.
+   */
+  uint32_t block_of(size_t entry) const { return entry_blocks_[entry]; }
+
+  /**
+   * @brief Gets the offset of an entry's data in its decompressed block.
+   * @param entry The entry, in archive order.
+   * @return The offset in bytes.
+   */
+  size_t offset(size_t entry) const { return entry_offsets_[entry]; }
+
+  /**
+   * @brief Gets the packed size of an entry, estimated for merged entries as in
+   *        `LzxEntry::pack_size()`.
+   * @param entry The entry, in archive order.
+   * @return The packed size in bytes; 0 for a merged entry whose data is missing.
+   */
+  size_t pack_size(size_t entry) const;
+
+  /**
+   * @brief Gets the entries sorted by name, ties in archive order.
+   * @return The entry indices.
+   */
+  std::span<const uint32_t> by_name() const { return by_name_; }
+
+  /**
+   * @brief Finds an entry by name.
+   * @param name The name, as stored in the archive.
+   * @return The first entry with this name, or std::nullopt if there is none.
+   */
+  std::optional<size_t> find(std::string_view name) const;
+
+  /**
+   * @brief Gets a block, creating it on first use.
+   *
+   * Not thread-safe: create the blocks needed before handing them to other threads.
+   *
+   * @param block The block index.
+   * @return The block, or nullptr if its header cannot be read.
+   */
+  std::shared_ptr<LzxBlock> block(size_t block);
+
+  /**
+   * @brief Creates an LzxEntry for one entry, for use with the extraction classes.
+   *
+   * Not thread-safe, like `block()`.
+   *
+   * @param entry The entry, in archive order.
+   * @return The entry, with no segments if its data is missing, or std::nullopt if its header
+   *         cannot be read.
+   */
+  std::optional<LzxEntry> entry(size_t entry);
+
+ private:
+  ArchiveIndex(InputBuffer buffer, std::shared_ptr<BlockCache> cache);
+
+  // The columns built by `from_buffer()`.
+  struct Columns {
+    std::vector<size_t>   header_offsets;
+    std::vector<uint32_t> entry_blocks;
+    std::vector<size_t>   entry_offsets;
+    std::vector<uint32_t> by_name;
+    std::vector<uint32_t> block_headers;
+    std::vector<size_t>   block_data_offsets;
+    std::vector<size_t>   block_unpack_sizes;
+  };
+
+  // Points the columns at `columns_`.
+  void use_columns();
+
+  // Whether every offset and index in the columns stays within the columns and the archive.
+  bool columns_valid() const;
+
+  // CRC-32 of the fixed part of a sample of the headers, read at the indexed offsets.
+  std::optional<uint32_t> header_hash() const;
+
+  InputBuffer                 buffer_;
+  std::span<const uint8_t>    data_;
+  std::shared_ptr<BlockCache> cache_;
+
+  // What the columns below point into: `columns_`, or the mapping of a loaded index.
+  Columns                          columns_;
+  std::unique_ptr<MmapInputBuffer> saved_;
+
+  // Per entry.
+  std::span<const size_t>   header_offsets_;
+  std::span<const uint32_t> entry_blocks_;
+  std::span<const size_t>   entry_offsets_;
+  std::span<const uint32_t> by_name_;
+
+  // Per block: the entry whose header carries the packed size, and the packed data.
+  std::span<const uint32_t>              block_headers_;
+  std::span<const size_t>                block_data_offsets_;
+  std::span<const size_t>                block_unpack_sizes_;
+  std::vector<std::shared_ptr<LzxBlock>> blocks_;
+};
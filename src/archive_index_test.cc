@@ -0,0 +1,237 @@
+#include "archive_index.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "extractor.hh"
+#include "test_archive.hh"
+#include "test_encoder.hh"
+
+namespace {
+
+class ArchiveIndexTest : public ArchiveTest {};
+
+TEST_F(ArchiveIndexTest, MatchesListing) {
+  TestArchive archive;
+  archive.add_block({{"zeta", pattern(500, 1)}});
+  archive.add_block({{"beta", pattern(300, 2)}, {"alpha", pattern(0, 3)}, {"gamma", pattern(700, 4)}});
+  archive.add_block({{"delta", pattern(100, 5)}});
+  auto entries = open(archive);
+
+  std::unique_ptr<ArchiveIndex> index;
+  ASSERT_EQ(unlzx_.index_archive(index), Status::Ok);
+  ASSERT_EQ(index->size(), 5U);
+  EXPECT_EQ(index->block_count(), 3U);
+
+  EXPECT_EQ(index->name(0), "zeta");
+  EXPECT_EQ(index->name(3), "gamma");
+  EXPECT_EQ(index->block_of(0), 0U);
+  EXPECT_EQ(index->block_of(1), 1U);
+  EXPECT_EQ(index->block_of(3), 1U);
+  EXPECT_EQ(index->block_of(4), 2U);
+  EXPECT_EQ(index->offset(1), 0U);
+  EXPECT_EQ(index->offset(2), 300U);
+  EXPECT_EQ(index->offset(3), 300U);
+
+  std::vector<std::string> sorted;
+  for (uint32_t entry : index->by_name()) sorted.emplace_back(index->name(entry));
+  EXPECT_TRUE(std::is_sorted(sorted.begin(), sorted.end()));
+  ASSERT_EQ(sorted.size(), entries.size());
+
+  for (const auto& [name, entry] : entries) {
+    auto found = index->find(name);
+    ASSERT_TRUE(found.has_value()) << name;
+    EXPECT_EQ(index->header(*found).unpack_size(), entry.unpack_size());
+    EXPECT_EQ(index->header(*found).data_crc(), entry.metadata().data_crc());
+    EXPECT_TRUE(index->comment(*found).empty());
+  }
+  EXPECT_FALSE(index->find("epsilon").has_value());
+}
+
+TEST_F(ArchiveIndexTest, CreatesEntriesOnDemand) {
+  std::vector<uint8_t> expected;
+  auto                 packed = test_encoder::encode_random(60000, 20000, expected, 3);
+
+  TestArchive archive;
+  archive.add_block({{"a", std::vector<uint8_t>(expected.begin(), expected.begin() + 25000)},
+                        {"b", std::vector<uint8_t>(expected.begin() + 25000, expected.end())}},
+      packed);
+  open(archive);
+
+  std::unique_ptr<ArchiveIndex> index;
+  ASSERT_EQ(unlzx_.index_archive(index), Status::Ok);
+
+  auto b = index->entry(*index->find("b"));
+  auto a = index->entry(*index->find("a"));
+  ASSERT_TRUE(a.has_value() && b.has_value());
+  ASSERT_EQ(a->segments().size(), 1U);
+  EXPECT_EQ(a->segments().front().block(), b->segments().front().block());
+  EXPECT_EQ(Extractor::extract_entry(*a), Status::Ok);
+  EXPECT_EQ(Extractor::extract_entry(*b), Status::Ok);
+  EXPECT_EQ(read_file("b"), std::vector<uint8_t>(expected.begin() + 25000, expected.end()));
+}
+
+TEST_F(ArchiveIndexTest, KeepsEntriesBeforeDamagedHeader) {
+  TestArchive archive;
+  archive.add_block({{"first", pattern(100, 1)}});
+  size_t damaged = archive.bytes().size();
+  archive.add_block({{"second", pattern(100, 2)}});
+  auto bytes = archive.bytes();
+  bytes[damaged + 2] ^= 0xFF;
+  open(bytes);
+
+  std::unique_ptr<ArchiveIndex> index;
+  EXPECT_EQ(unlzx_.index_archive(index), Status::ChecksumInvalid);
+  ASSERT_EQ(index->size(), 1U);
+  EXPECT_EQ(index->name(0), "first");
+}
+
+TEST_F(ArchiveIndexTest, LoadsSavedIndex) {
+  TestArchive archive;
+  archive.add_block({{"zeta", pattern(500, 1)}});
+  archive.add_block({{"beta", pattern(300, 2)}, {"alpha", pattern(200, 3)}});
+  open(archive);
+
+  auto                          sidecar = root_ / "test.lzx.idx";
+  std::unique_ptr<ArchiveIndex> built;
+  ASSERT_EQ(unlzx_.index_archive(built, sidecar), Status::Ok);
+  ASSERT_TRUE(std::filesystem::exists(sidecar));
+
+  std::unique_ptr<ArchiveIndex> loaded;
+  ArchiveIndex::Stamp           stamp;
+  ASSERT_EQ(ArchiveIndex::stamp_of(root_ / "test.lzx", stamp), Status::Ok);
+  InputBuffer buffer(archive.bytes().data() + 10, archive.bytes().size() - 10);
+  ASSERT_EQ(ArchiveIndex::load(buffer, sidecar, stamp, loaded), Status::Ok);
+
+  ASSERT_EQ(loaded->size(), built->size());
+  EXPECT_EQ(loaded->block_count(), built->block_count());
+  for (size_t entry = 0; entry < built->size(); ++entry) {
+    EXPECT_EQ(loaded->name(entry), built->name(entry));
+    EXPECT_EQ(loaded->block_of(entry), built->block_of(entry));
+    EXPECT_EQ(loaded->offset(entry), built->offset(entry));
+    EXPECT_EQ(loaded->pack_size(entry), built->pack_size(entry));
+  }
+  EXPECT_TRUE(std::equal(loaded->by_name().begin(), loaded->by_name().end(), built->by_name().begin()));
+
+  auto alpha = loaded->entry(*loaded->find("alpha"));
+  ASSERT_TRUE(alpha.has_value());
+  EXPECT_EQ(Extractor::extract_entry(*alpha), Status::Ok);
+  EXPECT_EQ(read_file("alpha"), pattern(200, 3));
+}
+
+TEST_F(ArchiveIndexTest, LoadsSavedIndexOfManyEntries) {
+  // More entries than headers hashed, and an odd count, so the columns after the first of each
+  // type do not start on a multiple of their combined size.
+  TestArchive archive;
+  for (size_t index = 0; index < 201; ++index) {
+    archive.add_block({{"file" + std::to_string(index), pattern(index, static_cast<uint8_t>(index))}});
+  }
+  open(archive);
+
+  auto                          sidecar = root_ / "test.lzx.idx";
+  std::unique_ptr<ArchiveIndex> built;
+  ASSERT_EQ(unlzx_.index_archive(built, sidecar), Status::Ok);
+
+  std::unique_ptr<ArchiveIndex> loaded;
+  ArchiveIndex::Stamp           stamp;
+  ASSERT_EQ(ArchiveIndex::stamp_of(root_ / "test.lzx", stamp), Status::Ok);
+  InputBuffer buffer(archive.bytes().data() + 10, archive.bytes().size() - 10);
+  ASSERT_EQ(ArchiveIndex::load(buffer, sidecar, stamp, loaded), Status::Ok);
+  ASSERT_EQ(loaded->size(), 201U);
+  for (size_t entry = 0; entry < loaded->size(); ++entry) {
+    EXPECT_EQ(loaded->name(entry), built->name(entry));
+    EXPECT_EQ(loaded->block_of(entry), entry);
+    EXPECT_EQ(loaded->by_name()[entry], built->by_name()[entry]);
+  }
+}
+
+TEST_F(ArchiveIndexTest, RejectsStaleIndex) {
+  TestArchive archive;
+  archive.add_block({{"first", pattern(100, 1)}});
+  archive.add_block({{"second", pattern(100, 2)}});
+  open(archive);
+
+  auto                          sidecar = root_ / "test.lzx.idx";
+  std::unique_ptr<ArchiveIndex> index;
+  ASSERT_EQ(unlzx_.index_archive(index, sidecar), Status::Ok);
+
+  ArchiveIndex::Stamp stamp;
+  ASSERT_EQ(ArchiveIndex::stamp_of(root_ / "test.lzx", stamp), Status::Ok);
+  InputBuffer buffer(archive.bytes().data() + 10, archive.bytes().size() - 10);
+
+  ArchiveIndex::Stamp touched = stamp;
+  touched.mtime += 1;
+  EXPECT_EQ(ArchiveIndex::load(buffer, sidecar, touched, index), Status::StaleIndex);
+
+  // Same size and stamp, different headers.
+  TestArchive renamed;
+  renamed.add_block({{"first", pattern(100, 1)}});
+  renamed.add_block({{"Second", pattern(100, 2)}});
+  ASSERT_EQ(renamed.bytes().size(), archive.bytes().size());
+  InputBuffer renamed_buffer(renamed.bytes().data() + 10, renamed.bytes().size() - 10);
+  EXPECT_EQ(ArchiveIndex::load(renamed_buffer, sidecar, stamp, index), Status::StaleIndex);
+
+  EXPECT_EQ(ArchiveIndex::load(buffer, root_ / "missing.idx", stamp, index), Status::FileOpenError);
+  EXPECT_EQ(ArchiveIndex::load(buffer, sidecar, stamp, index), Status::Ok);
+}
+
+TEST_F(ArchiveIndexTest, RejectsDamagedHeaderOfLoadedIndex) {
+  TestArchive archive;
+  archive.add_block({{"first", pattern(100, 1)}});
+  archive.add_block({{"second", pattern(100, 2)}});
+  open(archive);
+
+  auto                          sidecar = root_ / "test.lzx.idx";
+  std::unique_ptr<ArchiveIndex> index;
+  ASSERT_EQ(unlzx_.index_archive(index, sidecar), Status::Ok);
+  ArchiveIndex::Stamp stamp;
+  ASSERT_EQ(ArchiveIndex::stamp_of(root_ / "test.lzx", stamp), Status::Ok);
+
+  // The name is not part of the hashed headers, but its header checksum no longer matches.
+  auto bytes = archive.bytes();
+  auto name  = std::search(bytes.begin(), bytes.end(), std::begin("second"), std::end("second") - 1);
+  ASSERT_NE(name, bytes.end());
+  *name = 'S';
+  InputBuffer buffer(bytes.data() + 10, bytes.size() - 10);
+  ASSERT_EQ(ArchiveIndex::load(buffer, sidecar, stamp, index), Status::Ok);
+  EXPECT_TRUE(index->entry(0).has_value());
+  EXPECT_FALSE(index->entry(1).has_value());
+}
+
+TEST_F(ArchiveIndexTest, RejectsDamagedColumns) {
+  TestArchive archive;
+  archive.add_block({{"first", pattern(100, 1)}});
+  archive.add_block({{"second", pattern(100, 2)}, {"third", pattern(50, 3)}});
+  open(archive);
+
+  auto                          sidecar = root_ / "test.lzx.idx";
+  std::unique_ptr<ArchiveIndex> index;
+  ASSERT_EQ(unlzx_.index_archive(index, sidecar), Status::Ok);
+  auto saved = read_file(sidecar);
+
+  ArchiveIndex::Stamp stamp;
+  ASSERT_EQ(ArchiveIndex::stamp_of(root_ / "test.lzx", stamp), Status::Ok);
+  InputBuffer buffer(archive.bytes().data() + 10, archive.bytes().size() - 10);
+
+  // The columns follow a 56-byte header: header offsets, entry offsets, block data offsets and
+  // block sizes, then the 32-bit columns.
+  auto damage = [&](size_t column_offset, size_t value) {
+    auto bytes = saved;
+    std::copy_n(reinterpret_cast<const uint8_t*>(&value), sizeof(value), bytes.begin() + 56 + column_offset);
+    std::ofstream out(sidecar, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    out.close();
+    return ArchiveIndex::load(buffer, sidecar, stamp, index);
+  };
+  const size_t kWord = sizeof(size_t);
+  EXPECT_EQ(damage(kWord, archive.bytes().size()), Status::StaleIndex);      // Header offset.
+  EXPECT_EQ(damage(5 * kWord, 1000), Status::StaleIndex);                     // Entry offset.
+  EXPECT_EQ(damage(6 * kWord, archive.bytes().size()), Status::StaleIndex);  // Block data.
+  EXPECT_EQ(damage(9 * kWord, ~size_t{0}), Status::StaleIndex);              // Block size.
+  EXPECT_EQ(damage(0, 0), Status::Ok);
+}
+
+}  // namespace
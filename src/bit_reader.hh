@@ -0,0 +1,185 @@
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+/**
+ * @brief Bit stream reader backed by a 64-bit accumulator.
+ *
+ * The stream is a sequence of big-endian 16-bit words whose bits are consumed LSB first, the same
+ * layout `InputBuffer::read_bits` decodes. Unlike `InputBuffer`, bits are fetched in bulk by
+ * `refill()`, and `peek()`/`consume()` carry no status: reads past the end of the data yield zero
+ * bits and are reported once through `overrun()`.
+ */
+class BitReader {
+ public:
+  /// Minimum number of buffered bits guaranteed after `refill()`.
+  static constexpr size_t kMinBitsAfterRefill = 48;
+
+  /**
+   * @brief Default constructor for BitReader.
+   */
+  constexpr BitReader() = default;
+
+  /**
+   * @brief Constructs a BitReader over the given data.
+   * @param data The packed bit stream.
+   */
+  constexpr explicit BitReader(std::span<const uint8_t> data)
+      : data_{data.data()}, size_{data.size()} {}
+
+  /**
+   * @brief Constructs a BitReader over the given data, after bits left over from earlier data.
+   * @param data The packed bit stream following the left over bits.
+   * @param bits The left over bits, next bit first, as returned by `buffered_bits()`.
+   * @param count The number of left over bits, at most 64.
+   */
+  constexpr BitReader(std::span<const uint8_t> data, uint64_t bits, size_t count)
+      : data_{data.data()}, size_{data.size()}, bits_{bits}, bit_count_{count} {}
+
+  /**
+   * @brief Tops up the accumulator so that at least `kMinBitsAfterRefill` bits can be peeked.
+   */
+  void refill() {
+    if (bit_count_ > kMinBitsAfterRefill) return;
+
+    if (can_refill_unchecked()) {
+      refill_unchecked();
+      return;
+    }
+
+    refill_tail();
+  }
+
+  /**
+   * @brief Checks whether `refill_unchecked()` may be used.
+   * @return True if at least eight bytes of data remain unread, false otherwise.
+   */
+  bool can_refill_unchecked() const {
+    return size_ - position_ >= sizeof(uint64_t);
+  }
+
+  /**
+   * @brief Same as `refill()`, without the end of data check.
+   *
+   * The caller must ensure `can_refill_unchecked()` holds.
+   */
+  void refill_unchecked() {
+    if (bit_count_ > kMinBitsAfterRefill) return;
+
+    uint64_t chunk;
+    std::memcpy(&chunk, data_ + position_, sizeof(chunk));
+    if constexpr (std::endian::native == std::endian::big) {
+      chunk = std::byteswap(chunk);
+    }
+    // Swap the bytes of every 16-bit word, keeping the words in stream order.
+    chunk = ((chunk & 0x00FF00FF00FF00FFULL) << 8) | ((chunk >> 8) & 0x00FF00FF00FF00FFULL);
+
+    size_t words = (64 - bit_count_) / 16;
+    size_t bits  = words * 16;
+    bits_ |= (chunk & (~0ULL >> (64 - bits))) << bit_count_;
+    bit_count_ += bits;
+    position_ += words * 2;
+  }
+
+  /**
+   * @brief Peeks the requested number of bits without consuming them.
+   * @param count The number of bits to peek; must not exceed the buffered bit count.
+   * @return The peeked bits.
+   */
+  uint32_t peek(size_t count) const {
+    return static_cast<uint32_t>(bits_ & ((1ULL << count) - 1));
+  }
+
+  /**
+   * @brief Consumes the requested number of bits.
+   * @param count The number of bits to drop; must not exceed the buffered bit count.
+   */
+  void consume(size_t count) {
+    bits_ >>= count;
+    bit_count_ -= count;
+  }
+
+  /**
+   * @brief Refills the accumulator if needed, then reads the requested number of bits.
+   * @param count The number of bits to read, at most `kMinBitsAfterRefill`.
+   * @return The read bits.
+   */
+  uint32_t read(size_t count) {
+    refill();
+    uint32_t result = peek(count);
+    consume(count);
+    return result;
+  }
+
+  /**
+   * @brief Checks whether any consumed bit came from past the end of the data.
+   * @return True if the stream was read beyond its end, false otherwise.
+   */
+  bool overrun() const {
+    return bit_count_ < padding_bits_;
+  }
+
+  /**
+   * @brief Gets the number of bytes of data moved into the accumulator so far.
+   * @return The read position in the data.
+   */
+  size_t position() const {
+    return position_;
+  }
+
+  /**
+   * @brief Gets the bits of the data in the accumulator that have not been consumed yet.
+   *
+   * Together with `buffered_count()`, this lets a reader over the data that follows carry on where
+   * this one stops. Only valid without an `overrun()`.
+   *
+   * @return The bits, next bit first.
+   */
+  uint64_t buffered_bits() const {
+    return bits_;
+  }
+
+  /**
+   * @brief Gets the number of bits `buffered_bits()` holds, without the padding past the data.
+   * @return The number of bits.
+   */
+  size_t buffered_count() const {
+    return bit_count_ - padding_bits_;
+  }
+
+  /**
+   * @brief Checks whether every bit of the data has been consumed.
+   * @return True if no unread data bits remain, false otherwise.
+   */
+  bool is_eof() const {
+    return position_ + 2 > size_ && bit_count_ <= padding_bits_;
+  }
+
+ private:
+  // Word-at-a-time refill for the last few bytes, padding with zeros past the end.
+  void refill_tail() {
+    while (bit_count_ <= kMinBitsAfterRefill) {
+      uint64_t word = 0;
+      if (position_ + 2 <= size_) {
+        word = (data_[position_] << 8) | data_[position_ + 1];
+        position_ += 2;
+      } else {
+        padding_bits_ += 16;
+      }
+      bits_ |= word << bit_count_;
+      bit_count_ += 16;
+    }
+  }
+
+  const uint8_t* data_{};
+  size_t         size_{};
+  size_t         position_{};
+
+  uint64_t bits_{};
+  size_t   bit_count_{};
+  size_t   padding_bits_{};
+};
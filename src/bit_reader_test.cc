@@ -0,0 +1,86 @@
+#include "bit_reader.hh"
+
+#include <gtest/gtest.h>
+
+TEST(BitReaderTest, ReadBits) {
+  const uint8_t kTestData[] = {0x12, 0x34, 0x56, 0x78};
+  BitReader     reader(kTestData);
+
+  EXPECT_EQ(reader.read(4), 0x4);
+  EXPECT_EQ(reader.read(4), 0x3);
+  EXPECT_EQ(reader.read(8), 0x12);
+  EXPECT_EQ(reader.read(4), 0x8);
+  EXPECT_EQ(reader.read(4), 0x7);
+  EXPECT_EQ(reader.read(8), 0x56);
+  EXPECT_FALSE(reader.overrun());
+  EXPECT_TRUE(reader.is_eof());
+}
+
+TEST(BitReaderTest, ReadBitsAcrossBulkRefill) {
+  const uint8_t kTestData[] = {
+      0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0, 0x0F, 0xED, 0xCB, 0xA9};
+  BitReader reader(kTestData);
+
+  EXPECT_EQ(reader.read(3), 0x4);
+  EXPECT_EQ(reader.read(16), 0x0246);
+  EXPECT_EQ(reader.read(32), 0x13578ACF);
+  EXPECT_EQ(reader.read(20), 0xDBBDE);
+  EXPECT_EQ(reader.read(25), 0x197521F);
+  EXPECT_FALSE(reader.overrun());
+  EXPECT_TRUE(reader.is_eof());
+}
+
+TEST(BitReaderTest, PeekDoesNotConsume) {
+  const uint8_t kTestData[] = {0x12, 0x34};
+  BitReader     reader(kTestData);
+
+  reader.refill();
+  EXPECT_EQ(reader.peek(8), 0x34);
+  EXPECT_EQ(reader.peek(8), 0x34);
+  reader.consume(4);
+  EXPECT_EQ(reader.peek(8), 0x23);
+}
+
+TEST(BitReaderTest, ReadPastEndReportsOverrun) {
+  const uint8_t kTestData[] = {0x12, 0x34};
+  BitReader     reader(kTestData);
+
+  EXPECT_EQ(reader.read(16), 0x1234);
+  EXPECT_FALSE(reader.overrun());
+  EXPECT_EQ(reader.read(1), 0);
+  EXPECT_TRUE(reader.overrun());
+}
+
+TEST(BitReaderTest, IgnoresTrailingOddByte) {
+  const uint8_t kTestData[] = {0x12, 0x34, 0x56};
+  BitReader     reader(kTestData);
+
+  EXPECT_EQ(reader.read(16), 0x1234);
+  EXPECT_TRUE(reader.is_eof());
+}
+
+TEST(BitReaderTest, UncheckedRefillNeedsEightBytes) {
+  const uint8_t kTestData[] = {0x12, 0x34, 0x56, 0x78, 0x9A, 0xBC, 0xDE, 0xF0, 0x0F, 0xED};
+  BitReader     reader(kTestData);
+
+  EXPECT_TRUE(reader.can_refill_unchecked());
+  reader.refill_unchecked();
+  EXPECT_EQ(reader.peek(32), 0x56781234);
+  EXPECT_FALSE(reader.can_refill_unchecked());
+}
+
+TEST(BitReaderTest, CarriesBufferedBitsToNextData) {
+  const uint8_t kFirst[]  = {0x12, 0x34};
+  const uint8_t kSecond[] = {0x56, 0x78};
+  BitReader     first(kFirst);
+
+  EXPECT_EQ(first.read(4), 0x4);
+  EXPECT_EQ(first.position(), 2U);
+  ASSERT_EQ(first.buffered_count(), 12U);
+
+  BitReader second(kSecond, first.buffered_bits(), first.buffered_count());
+  EXPECT_EQ(second.read(20), 0x78123);
+  EXPECT_EQ(second.read(8), 0x56);
+  EXPECT_FALSE(second.overrun());
+  EXPECT_TRUE(second.is_eof());
+}
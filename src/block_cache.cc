@@ -0,0 +1,76 @@
+#include "block_cache.hh"
+
+#include <iterator>
+
+#include "lzx_block.hh"
+
+BlockCache::Stats BlockCache::stats() const {
+  std::lock_guard lock(mutex_);
+  return stats_;
+}
+
+void BlockCache::touch(LzxBlock* block) {
+  std::lock_guard lock(mutex_);
+  auto            slot = slots_.find(block);
+  if (slot == slots_.end()) return;
+  ++stats_.hits;
+  lru_.splice(lru_.begin(), lru_, slot->second.position);
+}
+
+void BlockCache::insert(LzxBlock* block, size_t bytes) {
+  std::lock_guard lock(mutex_);
+  ++stats_.misses;
+  add(block, bytes);
+}
+
+void BlockCache::charge(LzxBlock* block, size_t bytes) {
+  std::lock_guard lock(mutex_);
+  add(block, bytes);
+}
+
+void BlockCache::add(LzxBlock* block, size_t bytes) {
+  auto slot = slots_.find(block);
+  if (slot == slots_.end()) {
+    lru_.push_front(block);
+    slots_.emplace(block, Slot{lru_.begin(), bytes});
+  } else {
+    slot->second.bytes += bytes;
+    lru_.splice(lru_.begin(), lru_, slot->second.position);
+  }
+  stats_.resident_bytes += bytes;
+
+  // Oldest first; the new block sits at the front and is never a victim.
+  auto victim = std::prev(lru_.end());
+  while (stats_.resident_bytes > budget_ && victim != lru_.begin()) {
+    auto previous = std::prev(victim);
+    if (!pins_.contains(*victim)) {
+      auto slot = slots_.find(*victim);
+      stats_.resident_bytes -= slot->second.bytes;
+      ++stats_.evictions;
+      (*victim)->free_data();
+      slots_.erase(slot);
+      lru_.erase(victim);
+    }
+    victim = previous;
+  }
+}
+
+void BlockCache::erase(LzxBlock* block) {
+  std::lock_guard lock(mutex_);
+  auto            slot = slots_.find(block);
+  if (slot == slots_.end()) return;
+  stats_.resident_bytes -= slot->second.bytes;
+  lru_.erase(slot->second.position);
+  slots_.erase(slot);
+}
+
+void BlockCache::pin(LzxBlock* block) {
+  std::lock_guard lock(mutex_);
+  ++pins_[block];
+}
+
+void BlockCache::unpin(LzxBlock* block) {
+  std::lock_guard lock(mutex_);
+  auto            pin = pins_.find(block);
+  if (pin != pins_.end() && --pin->second == 0) pins_.erase(pin);
+}
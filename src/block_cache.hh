@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+class LzxBlock;
+
+/**
+ * @brief Keeps the decompressed data of an archive's most recently used blocks within a budget.
+ *
+ * Blocks sharing a cache report each use of their data to it. When a decompression takes the
+ * resident data over the budget, the least recently used blocks are released, and decompressed
+ * again on their next `LzxBlock::data()`. The checkpoints `LzxBlock::read()` saves count against
+ * the budget too, and are dropped with the data. Stored blocks point into the archive mapping and
+ * are not counted. The block just decompressed is never evicted, so a single block larger than the
+ * budget still decodes.
+ *
+ * Eviction frees a block's data, so a span from `LzxBlock::data()` stays valid only until another
+ * block of the same cache is decompressed, unless the block is pinned. The cache itself is
+ * thread-safe; blocks are not, as without a cache.
+ */
+class BlockCache {
+ public:
+  /**
+   * @brief Usage counters.
+   */
+  struct Stats {
+    uint64_t hits{};            ///< `data()` calls served from resident data.
+    uint64_t misses{};          ///< Blocks decompressed.
+    uint64_t evictions{};       ///< Blocks released to stay within the budget.
+    size_t   resident_bytes{};  ///< Decompressed data and checkpoints currently held.
+  };
+
+  /**
+   * @brief Constructs a new BlockCache.
+   * @param budget Maximum bytes of decompressed data to keep.
+   */
+  explicit BlockCache(size_t budget) : budget_(budget) {}
+
+  BlockCache(const BlockCache&)            = delete;
+  BlockCache& operator=(const BlockCache&) = delete;
+
+  /**
+   * @brief Gets the budget.
+   * @return The maximum bytes of decompressed data to keep.
+   */
+  size_t budget() const { return budget_; }
+
+  /**
+   * @brief Gets the usage counters.
+   * @return The counters so far.
+   */
+  Stats stats() const;
+
+ private:
+  friend class LzxBlock;
+
+  struct Slot {
+    std::list<LzxBlock*>::iterator position;
+    size_t                         bytes{};
+  };
+
+  // Marks a resident block as most recently used.
+  void touch(LzxBlock* block);
+
+  // Adds a block that was just decompressed, then evicts others until within the budget.
+  void insert(LzxBlock* block, size_t bytes);
+
+  // Adds memory a block holds besides its data, such as checkpoints, like `insert()`.
+  void charge(LzxBlock* block, size_t bytes);
+
+  // Counts bytes to a block, making it the most recently used, then evicts others.
+  void add(LzxBlock* block, size_t bytes);
+
+  // Forgets a block whose data was freed outside the cache.
+  void erase(LzxBlock* block);
+
+  // Pinned blocks are not evicted; pins nest.
+  void pin(LzxBlock* block);
+  void unpin(LzxBlock* block);
+
+  mutable std::mutex                        mutex_;
+  size_t                                    budget_;
+  // Most recently used first.
+  std::list<LzxBlock*>                      lru_;
+  std::unordered_map<const LzxBlock*, Slot> slots_;
+  std::unordered_map<const LzxBlock*, size_t> pins_;
+  Stats                                     stats_;
+};
@@ -0,0 +1,163 @@
+#include "block_cache.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "block_decoder.hh"
+#include "extractor.hh"
+#include "test_archive.hh"
+#include "test_encoder.hh"
+
+namespace {
+
+class BlockCacheTest : public ArchiveTest {
+ protected:
+  static constexpr size_t kFileSize = 20000;
+
+  /// Opens an archive of `count` compressed single-file blocks with the given cache budget.
+  std::map<std::string, LzxEntry> open_files(size_t count, size_t budget) {
+    TestArchive archive;
+    for (size_t index = 0; index < count; ++index) {
+      std::vector<uint8_t> expected;
+      auto packed = test_encoder::encode_random(kFileSize, kFileSize, expected, static_cast<uint32_t>(index + 1));
+      files_.push_back({"file" + std::to_string(index), expected});
+      archive.add_block({files_.back()}, packed);
+    }
+    unlzx_.set_block_cache(budget);
+    return open(archive);
+  }
+
+  bool matches(const LzxEntry& entry, size_t index) {
+    auto data = entry.segments().front().data();
+    return std::equal(data.begin(), data.end(), files_[index].data.begin(), files_[index].data.end());
+  }
+
+  std::vector<TestArchive::File> files_;
+};
+
+TEST_F(BlockCacheTest, EvictsLeastRecentlyUsed) {
+  auto entries = open_files(3, 2 * kFileSize);
+
+  EXPECT_TRUE(matches(entries.at("file0"), 0));
+  EXPECT_TRUE(matches(entries.at("file1"), 1));
+  EXPECT_TRUE(matches(entries.at("file0"), 0));  // Hit; file1 is now the oldest.
+  EXPECT_TRUE(matches(entries.at("file2"), 2));  // Evicts file1.
+
+  auto stats = unlzx_.block_cache_stats();
+  ASSERT_TRUE(stats.has_value());
+  EXPECT_EQ(stats->hits, 1U);
+  EXPECT_EQ(stats->misses, 3U);
+  EXPECT_EQ(stats->evictions, 1U);
+  EXPECT_EQ(stats->resident_bytes, 2 * kFileSize);
+
+  EXPECT_TRUE(matches(entries.at("file0"), 0));  // Still resident.
+  EXPECT_TRUE(matches(entries.at("file1"), 1));  // Decoded again; evicts file2.
+  stats = unlzx_.block_cache_stats();
+  EXPECT_EQ(stats->hits, 2U);
+  EXPECT_EQ(stats->misses, 4U);
+  EXPECT_EQ(stats->evictions, 2U);
+}
+
+TEST_F(BlockCacheTest, KeepsBlockLargerThanBudget) {
+  auto entries = open_files(2, kFileSize / 2);
+
+  EXPECT_TRUE(matches(entries.at("file0"), 0));
+  EXPECT_TRUE(matches(entries.at("file1"), 1));
+  auto stats = unlzx_.block_cache_stats();
+  EXPECT_EQ(stats->evictions, 1U);
+  EXPECT_EQ(stats->resident_bytes, kFileSize);
+}
+
+TEST_F(BlockCacheTest, DoesNotEvictPinnedBlocks) {
+  auto entries = open_files(2, kFileSize);
+  auto block   = entries.at("file0").segments().front().block();
+
+  block->pin();
+  EXPECT_TRUE(matches(entries.at("file0"), 0));
+  EXPECT_TRUE(matches(entries.at("file1"), 1));
+  EXPECT_EQ(unlzx_.block_cache_stats()->evictions, 0U);
+  EXPECT_EQ(unlzx_.block_cache_stats()->resident_bytes, 2 * kFileSize);
+
+  block->unpin();
+  EXPECT_TRUE(matches(entries.at("file1"), 1));
+  EXPECT_EQ(unlzx_.block_cache_stats()->hits, 1U);
+  block.reset();
+  entries.clear();
+  EXPECT_EQ(unlzx_.block_cache_stats()->resident_bytes, 0U);
+}
+
+TEST_F(BlockCacheTest, SharesCacheBetweenThreads) {
+  auto entries = open_files(4, kFileSize);
+
+  // Each thread decodes its own blocks, which keep evicting the blocks of the other thread.
+  auto decode = [&](size_t first, bool& ok) {
+    ok = true;
+    for (size_t round = 0; round < 20; ++round) {
+      for (size_t index = first; index < files_.size(); index += 2) {
+        const auto&         entry = entries.at(files_[index].name);
+        LzxBlock::ScopedPin pin(entry.segments().front().block().get());
+        ok = matches(entry, index) && ok;
+      }
+    }
+  };
+  bool ok0 = false;
+  bool ok1 = false;
+  std::thread thread0(decode, 0, std::ref(ok0));
+  std::thread thread1(decode, 1, std::ref(ok1));
+  thread0.join();
+  thread1.join();
+  EXPECT_TRUE(ok0);
+  EXPECT_TRUE(ok1);
+  EXPECT_GT(unlzx_.block_cache_stats()->evictions, 0U);
+}
+
+TEST_F(BlockCacheTest, CountsAndEvictsCheckpoints) {
+  std::vector<uint8_t> expected;
+  auto                 packed = test_encoder::encode_random(3 << 20, 50000, expected, 7);
+
+  TestArchive archive;
+  archive.add_block({{"large", expected}}, packed);
+  std::vector<uint8_t> small;
+  auto                 small_packed = test_encoder::encode_random(kFileSize, kFileSize, small, 8);
+  archive.add_block({{"small", small}}, small_packed);
+  unlzx_.set_block_cache(kFileSize);
+  auto entries = open(archive);
+
+  // Reading near the end saves a checkpoint per MiB; they alone exceed the budget.
+  std::vector<uint8_t> out(100);
+  size_t               count = 0;
+  ASSERT_EQ(entries.at("large").read(expected.size() - 200, out, count), Status::Ok);
+  EXPECT_TRUE(std::equal(out.begin(), out.end(), expected.end() - 200));
+  auto stats = unlzx_.block_cache_stats();
+  EXPECT_GT(stats->resident_bytes, 2 * huffman::BlockDecoder::kWindowSize);
+  EXPECT_EQ(stats->misses, 0U);
+
+  auto data = entries.at("small").segments().front().data();
+  EXPECT_TRUE(std::equal(data.begin(), data.end(), small.begin(), small.end()));
+  stats = unlzx_.block_cache_stats();
+  EXPECT_EQ(stats->evictions, 1U);
+  EXPECT_EQ(stats->resident_bytes, kFileSize);
+
+  // Without its checkpoints, the large block decodes from the start again.
+  ASSERT_EQ(entries.at("large").read(expected.size() - 200, out, count), Status::Ok);
+  EXPECT_TRUE(std::equal(out.begin(), out.end(), expected.end() - 200));
+}
+
+TEST_F(BlockCacheTest, ExtractsWithSmallBudget) {
+  auto entries = open_files(8, kFileSize);
+
+  std::vector<const LzxEntry*> selected;
+  for (const auto& [name, entry] : entries) selected.push_back(&entry);
+  for (Status status : Extractor(4).extract(selected)) EXPECT_EQ(status, Status::Ok);
+  for (const auto& file : files_) {
+    EXPECT_EQ(read_file(file.name), file.data) << file.name;
+  }
+  EXPECT_EQ(unlzx_.block_cache_stats()->resident_bytes, 0U);
+}
+
+}  // namespace
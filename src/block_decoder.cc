@@ -0,0 +1,104 @@
+#include "block_decoder.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "match_copy.hh"
+
+namespace huffman {
+
+static_assert(BlockDecoder::kStreamBufferSize >=
+              2 * BlockDecoder::kWindowSize + HuffmanDecoder::kMaxMatchLength + kMatchCopyOverrun);
+
+Status BlockDecoder::decode_until(std::span<uint8_t> buffer, size_t& pos, size_t limit) {
+  while (pos < limit) {
+    if (decrunch_length_ == 0) {
+      TRY(decoder_.read_literal_table(&reader_));
+      decrunch_length_ = decoder_.decrunch_length();
+    }
+
+    size_t target_size = std::min(pos + decrunch_length_, limit);
+
+    size_t old_pos = pos;
+    TRY(decoder_.decrunch(&reader_, buffer, pos, target_size));
+
+    size_t decoded_bytes = pos - old_pos;
+    if (decoded_bytes == 0 && reader_.is_eof()) return Status::UnexpectedEof;
+
+    if (decoded_bytes > decrunch_length_) {
+      decrunch_length_ = 0;
+    } else {
+      decrunch_length_ -= decoded_bytes;
+    }
+  }
+  return Status::Ok;
+}
+
+Status BlockDecoder::decode_to(std::span<uint8_t> target, size_t end, crc::SegmentCrc32* crcs) {
+  if (target.size() < unpacked_size_ + kOutputSlack) return Status::BufferOverflow;
+
+  end = std::min(end, unpacked_size_);
+  if (crcs == nullptr) return decode_until(target, pos_, end);
+
+  // Decode in small steps, and checksum each step while it is still in cache.
+  while (pos_ < end) {
+    TRY(decode_until(target, pos_, std::min(pos_ + kCrcChunkSize, end)));
+
+    size_t decoded = this->decoded();
+    crcs->update(checked_, target.subspan(checked_, decoded - checked_));
+    checked_ = decoded;
+  }
+  return Status::Ok;
+}
+
+// The buffer holds the last `kWindowSize` bytes of output followed by newly decoded data. Once the
+// new data reaches the limit, it is handed to the consumer and the window slides down to the start
+// of the buffer. The limit leaves room for the longest match and a wide match copy, so the decoder
+// never has to fall back to its checked loop before the end of the block. Slides happen between
+// symbols with a full window in the buffer, which is all a checkpoint needs.
+Status BlockDecoder::stream(const ChunkConsumer& consumer, size_t end, const Checkpoint* from,
+    std::vector<Checkpoint>* checkpoints) {
+  constexpr size_t kLimit =
+      kStreamBufferSize - HuffmanDecoder::kMaxMatchLength - kMatchCopyOverrun;
+
+  std::vector<uint8_t> buffer(kStreamBufferSize);
+  size_t               base    = 0;  // Output offset of the start of the buffer.
+  size_t               pos     = 0;
+  size_t               emitted = 0;
+
+  if (from != nullptr) {
+    TRY(decoder_.restore_state(from->decoder));
+    reader_          = from->reader;
+    decrunch_length_ = from->decrunch_length;
+    std::memcpy(buffer.data(), from->window.data(), from->window.size());
+    base    = from->offset - from->window.size();
+    pos     = from->window.size();
+    emitted = pos;
+  }
+
+  end = std::min(end, unpacked_size_);
+  while (base + pos < end) {
+    TRY(decode_until(buffer, pos, std::min(kLimit, end - base)));
+
+    size_t chunk_end = std::min(pos, end - base);
+    TRY(consumer(std::span<const uint8_t>(buffer.data() + emitted, chunk_end - emitted)));
+    emitted = chunk_end;
+
+    if (base + pos < end) {
+      size_t last = (checkpoints == nullptr || checkpoints->empty()) ? 0 : checkpoints->back().offset;
+      if (checkpoints != nullptr && base + pos >= last + kCheckpointInterval) {
+        checkpoints->push_back({base + pos, reader_, decrunch_length_, decoder_.save_state(),
+            std::vector<uint8_t>(buffer.data() + pos - kWindowSize, buffer.data() + pos)});
+      }
+
+      std::memmove(buffer.data(), buffer.data() + pos - kWindowSize, kWindowSize);
+      base += pos - kWindowSize;
+      pos     = kWindowSize;
+      emitted = kWindowSize;
+    }
+  }
+  return Status::Ok;
+}
+
+}  // namespace huffman
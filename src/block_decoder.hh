@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include "bit_reader.hh"
+#include "crc.hh"
+#include "error.hh"
+#include "huffman_decoder.hh"
+#include "huffman_table.hh"
+
+namespace huffman {
+
+/**
+ * @brief Receives decompressed data, one chunk at a time and in order.
+ *
+ * The chunk is only valid for the duration of the call. Any status other than Status::Ok stops
+ * decompression and is passed back to the caller.
+ */
+using ChunkConsumer = std::function<Status(std::span<const uint8_t>)>;
+
+/**
+ * @brief Decompresses one packed LZX block: a sequence of sub-blocks, each with its own tables.
+ */
+class BlockDecoder {
+ public:
+  /// History kept for matches; LZX offsets are below 64 KiB.
+  static constexpr size_t kWindowSize = size_t{1} << 16;
+
+  /// Size of the buffer used by `stream()`: the window plus room to decode new data.
+  static constexpr size_t kStreamBufferSize = size_t{1} << 18;
+
+  /// Bytes the target of `decode()` needs past the unpacked size.
+  static constexpr size_t kOutputSlack = 256;
+
+  /// Bytes `decode()` decodes between CRC updates, small enough to still be in cache.
+  static constexpr size_t kCrcChunkSize = size_t{1} << 15;
+
+  /// Output between the checkpoints `stream()` saves.
+  static constexpr size_t kCheckpointInterval = size_t{1} << 20;
+
+  /**
+   * @brief Decoder state between two symbols, from which `stream()` can resume.
+   */
+  struct Checkpoint {
+    size_t                offset{};           ///< Output offset decoding resumes at.
+    BitReader             reader;             ///< Input position.
+    size_t                decrunch_length{};  ///< Bytes left in the sub-block.
+    HuffmanDecoder::State decoder;            ///< Code tables and match state.
+    std::vector<uint8_t>  window;             ///< The `kWindowSize` bytes of output before `offset`.
+  };
+
+  /**
+   * @brief Constructs a new BlockDecoder.
+   * @param packed The packed block.
+   * @param unpacked_size The total size of the decompressed data.
+   */
+  BlockDecoder(std::span<const uint8_t> packed, size_t unpacked_size)
+      : reader_{packed}, unpacked_size_{unpacked_size} {}
+
+  /**
+   * @brief Decompresses the whole block into the target span.
+   * @param target At least `unpacked_size + kOutputSlack` bytes; bytes past the unpacked size are
+   *               overwritten with garbage.
+   * @param crcs If set, updated with every `kCrcChunkSize` bytes of output as they are decoded.
+   * @return Status indicating success or the specific error encountered.
+   */
+  Status decode(std::span<uint8_t> target, crc::SegmentCrc32* crcs = nullptr) {
+    return decode_to(target, unpacked_size_, crcs);
+  }
+
+  /**
+   * @brief Decompresses the block into the target span until at least `end` bytes are decoded.
+   *
+   * Decoding resumes where the previous call stopped, so a block can be decoded a prefix at a
+   * time. The last match may run past `end`; see `decoded()`.
+   *
+   * @param target The same span on every call; at least `unpacked_size + kOutputSlack` bytes.
+   * @param end The number of bytes needed; capped at the unpacked size.
+   * @param crcs If set, updated with the new output; pass the same value on every call.
+   * @return Status indicating success or the specific error encountered.
+   */
+  Status decode_to(std::span<uint8_t> target, size_t end, crc::SegmentCrc32* crcs = nullptr);
+
+  /**
+   * @brief Gets the number of bytes `decode_to()` has decoded so far.
+   * @return The length of the decoded prefix of the block.
+   */
+  size_t decoded() const {
+    return std::min(pos_, unpacked_size_);
+  }
+
+  /**
+   * @brief Decompresses the block through a sliding window of `kStreamBufferSize` bytes.
+   *
+   * Memory use does not depend on the size of the block. Each chunk passed to the consumer is at
+   * most `kStreamBufferSize` bytes long.
+   *
+   * @param consumer Receives the decompressed data.
+   * @param end Stop once this many bytes have been passed on; capped at the unpacked size.
+   * @param from If set, resume at this checkpoint of the same block instead of the start; output
+   *             before `from->offset` is not passed on.
+   * @param checkpoints If set, receives a checkpoint every `kCheckpointInterval` bytes or so past
+   *                    the last one it holds. `from` may point into it, as it is read first.
+   * @return Status indicating success, the consumer's error, or the specific error encountered.
+   */
+  Status stream(const ChunkConsumer& consumer, size_t end = SIZE_MAX,
+      const Checkpoint* from = nullptr, std::vector<Checkpoint>* checkpoints = nullptr);
+
+  /**
+   * @brief Gets the decode table cache counters.
+   * @return The number of Huffman tables reused and built so far.
+   */
+  HuffmanTableCache::Stats table_cache_stats() const {
+    return decoder_.table_cache_stats();
+  }
+
+ private:
+  // Decodes whole symbols into `buffer` until `pos` reaches `limit`. The last match may end past
+  // `limit`, by at most `kMaxMatchLength - 1` bytes.
+  Status decode_until(std::span<uint8_t> buffer, size_t& pos, size_t limit);
+
+  BitReader      reader_;
+  HuffmanDecoder decoder_;
+  size_t         unpacked_size_;
+  // Bytes left in the current sub-block.
+  size_t decrunch_length_{};
+  // Output position of `decode_to()`, and how much of the output has been checksummed.
+  size_t pos_{};
+  size_t checked_{};
+};
+
+}  // namespace huffman
@@ -0,0 +1,251 @@
+#include "block_decoder.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "huffman_decoder.hh"
+#include "huffman_table.hh"
+#include "test_encoder.hh"
+
+namespace {
+
+using huffman::BlockDecoder;
+using huffman::HuffmanDecoder;
+using test_encoder::encode_random;
+
+TEST(BlockDecoderTest, DecodesWholeBlock) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(200000, 30000, expected, 1);
+
+  std::vector<uint8_t> output(expected.size() + BlockDecoder::kOutputSlack);
+  BlockDecoder         decoder(packed, expected.size());
+  ASSERT_EQ(decoder.decode(output), Status::Ok);
+  output.resize(expected.size());
+  EXPECT_EQ(output, expected);
+}
+
+TEST(BlockDecoderTest, DecodesAllMethodsAndChangingCodes) {
+  std::vector<uint8_t>  expected;
+  test_encoder::Summary summary;
+  std::vector<uint8_t>  packed = encode_random(400000, 20000, expected, 9, {.random_codes = true},
+      &summary);
+  ASSERT_GT(summary.methods[1], 0U);
+  ASSERT_GT(summary.methods[2], 0U);
+  ASSERT_GT(summary.methods[3], 0U);
+
+  std::vector<uint8_t> output(expected.size() + BlockDecoder::kOutputSlack);
+  BlockDecoder         decoder(packed, expected.size());
+  ASSERT_EQ(decoder.decode(output), Status::Ok);
+  output.resize(expected.size());
+  EXPECT_EQ(output, expected);
+}
+
+TEST(BlockDecoderTest, DecodesLiteralCodesLongerThanRoot) {
+  std::vector<uint8_t>  expected;
+  test_encoder::Summary summary;
+  std::vector<uint8_t>  packed = encode_random(200000, 50000, expected, 11, {.random_codes = true},
+      &summary);
+  // The literal table resolves 12 bits in its root; longer codes go through a sub-table.
+  ASSERT_GT(summary.longest_literal_code, 12);
+
+  std::vector<uint8_t> output(expected.size() + BlockDecoder::kOutputSlack);
+  BlockDecoder         decoder(packed, expected.size());
+  ASSERT_EQ(decoder.decode(output), Status::Ok);
+  output.resize(expected.size());
+  EXPECT_EQ(output, expected);
+}
+
+TEST(BlockDecoderTest, DecodesLiteralPairs) {
+  // Long sub-blocks of mostly literals, few of them and with short codes.
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(300000, 2 * HuffmanDecoder::kMultiSymbolMinLength,
+      expected, 12,
+      {.random_codes = true, .short_literals = true, .literal_percent = 90, .literal_values = 16});
+
+  // The decoder takes the multi-symbol path for such a sub-block.
+  HuffmanDecoder first_block;
+  BitReader      reader(packed);
+  reader.refill();
+  ASSERT_EQ(first_block.read_literal_table(&reader), Status::Ok);
+  ASSERT_GE(first_block.decrunch_length(), HuffmanDecoder::kMultiSymbolMinLength);
+  huffman::HuffmanTable literals(12, 768);
+  literals.bit_length_ = first_block.save_state().literal_lengths;
+  ASSERT_EQ(literals.reset_table(), Status::Ok);
+  ASSERT_TRUE(huffman::MultiSymbolTable(12).is_profitable(literals, 256));
+
+  std::vector<uint8_t> output(expected.size() + BlockDecoder::kOutputSlack);
+  BlockDecoder         decoder(packed, expected.size());
+  ASSERT_EQ(decoder.decode(output), Status::Ok);
+  output.resize(expected.size());
+  EXPECT_EQ(output, expected);
+}
+
+TEST(BlockDecoderTest, ComputesSegmentCrcsWhileDecoding) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(300000, 40000, expected, 5);
+
+  // Segment boundaries that fall inside and across CRC steps.
+  const size_t      kEnds[] = {1, 5000, BlockDecoder::kCrcChunkSize, 150000, expected.size()};
+  crc::SegmentCrc32 crcs;
+  size_t            offset = 0;
+  for (size_t end : kEnds) {
+    crcs.add_segment(offset, end - offset);
+    offset = end;
+  }
+
+  std::vector<uint8_t> output(expected.size() + BlockDecoder::kOutputSlack);
+  BlockDecoder         decoder(packed, expected.size());
+  ASSERT_EQ(decoder.decode(output, &crcs), Status::Ok);
+
+  offset = 0;
+  for (size_t index = 0; index < std::size(kEnds); ++index) {
+    crc::Crc32 crc;
+    crc.calc(expected.data() + offset, kEnds[index] - offset);
+    EXPECT_EQ(crcs.sum(index), crc.sum()) << index;
+    offset = kEnds[index];
+  }
+}
+
+TEST(BlockDecoderTest, ResumesPartialDecode) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(300000, 40000, expected, 6);
+
+  crc::SegmentCrc32 crcs;
+  crcs.add_segment(0, 100000);
+  crcs.add_segment(100000, expected.size() - 100000);
+
+  std::vector<uint8_t> output(expected.size() + BlockDecoder::kOutputSlack);
+  BlockDecoder         decoder(packed, expected.size());
+  ASSERT_EQ(decoder.decode_to(output, 1000, &crcs), Status::Ok);
+  EXPECT_GE(decoder.decoded(), 1000U);
+  EXPECT_LT(decoder.decoded(), 1000U + BlockDecoder::kCrcChunkSize);
+  EXPECT_TRUE(std::equal(output.begin(), output.begin() + decoder.decoded(), expected.begin()));
+
+  ASSERT_EQ(decoder.decode_to(output, 100000, &crcs), Status::Ok);
+  crc::Crc32 first;
+  first.calc(expected.data(), 100000);
+  EXPECT_EQ(crcs.sum(0), first.sum());
+
+  ASSERT_EQ(decoder.decode_to(output, SIZE_MAX, &crcs), Status::Ok);
+  EXPECT_EQ(decoder.decoded(), expected.size());
+  output.resize(expected.size());
+  EXPECT_EQ(output, expected);
+}
+
+TEST(BlockDecoderTest, StreamsPrefix) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(3 * BlockDecoder::kStreamBufferSize, 100000, expected,
+      7);
+
+  std::vector<uint8_t> output;
+  BlockDecoder         decoder(packed, expected.size());
+  ASSERT_EQ(decoder.stream([&](std::span<const uint8_t> chunk) {
+    output.insert(output.end(), chunk.begin(), chunk.end());
+    return Status::Ok;
+  }, 5000),
+      Status::Ok);
+  EXPECT_EQ(output, std::vector<uint8_t>(expected.begin(), expected.begin() + 5000));
+}
+
+TEST(BlockDecoderTest, ResumesFromCheckpoints) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(3 * BlockDecoder::kCheckpointInterval + 12345, 70000,
+      expected, 8);
+
+  std::vector<BlockDecoder::Checkpoint> checkpoints;
+  BlockDecoder                          first(packed, expected.size());
+  ASSERT_EQ(first.stream([](std::span<const uint8_t>) { return Status::Ok; }, SIZE_MAX, nullptr,
+                &checkpoints),
+      Status::Ok);
+  ASSERT_GE(checkpoints.size(), 2U);
+
+  for (const auto& checkpoint : checkpoints) {
+    EXPECT_GE(checkpoint.offset, BlockDecoder::kCheckpointInterval);
+    std::vector<uint8_t> output;
+    BlockDecoder         decoder(packed, expected.size());
+    ASSERT_EQ(decoder.stream([&](std::span<const uint8_t> chunk) {
+      output.insert(output.end(), chunk.begin(), chunk.end());
+      return Status::Ok;
+    }, SIZE_MAX, &checkpoint),
+        Status::Ok);
+    EXPECT_TRUE(std::equal(output.begin(), output.end(), expected.begin() + checkpoint.offset,
+        expected.end()));
+    EXPECT_EQ(output.size(), expected.size() - checkpoint.offset);
+  }
+}
+
+TEST(BlockDecoderTest, ResumesFromCheckpointsWithChangingCodes) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(2 * BlockDecoder::kCheckpointInterval + 5000, 30000,
+      expected, 10, {.random_codes = true});
+
+  std::vector<BlockDecoder::Checkpoint> checkpoints;
+  BlockDecoder                          first(packed, expected.size());
+  ASSERT_EQ(first.stream([](std::span<const uint8_t>) { return Status::Ok; }, SIZE_MAX, nullptr,
+                &checkpoints),
+      Status::Ok);
+  ASSERT_FALSE(checkpoints.empty());
+
+  for (const auto& checkpoint : checkpoints) {
+    std::vector<uint8_t> output;
+    BlockDecoder         decoder(packed, expected.size());
+    ASSERT_EQ(decoder.stream([&](std::span<const uint8_t> chunk) {
+      output.insert(output.end(), chunk.begin(), chunk.end());
+      return Status::Ok;
+    }, SIZE_MAX, &checkpoint),
+        Status::Ok);
+    EXPECT_TRUE(std::equal(output.begin(), output.end(), expected.begin() + checkpoint.offset,
+        expected.end()));
+    EXPECT_EQ(output.size(), expected.size() - checkpoint.offset);
+  }
+}
+
+TEST(BlockDecoderTest, StreamsThroughWindow) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(3 * BlockDecoder::kStreamBufferSize, 100000, expected,
+      2);
+
+  std::vector<uint8_t> output;
+  size_t               chunks = 0;
+  BlockDecoder         decoder(packed, expected.size());
+  ASSERT_EQ(decoder.stream([&](std::span<const uint8_t> chunk) {
+    EXPECT_LE(chunk.size(), BlockDecoder::kStreamBufferSize);
+    output.insert(output.end(), chunk.begin(), chunk.end());
+    chunks++;
+    return Status::Ok;
+  }),
+      Status::Ok);
+
+  EXPECT_GT(chunks, 3);
+  EXPECT_EQ(output, expected);
+  EXPECT_GT(decoder.table_cache_stats().hits, 0);
+}
+
+TEST(BlockDecoderTest, StopsOnConsumerError) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(BlockDecoder::kStreamBufferSize * 2, 50000, expected,
+      3);
+
+  size_t       chunks = 0;
+  BlockDecoder decoder(packed, expected.size());
+  EXPECT_EQ(decoder.stream([&](std::span<const uint8_t>) {
+    chunks++;
+    return Status::FileWriteError;
+  }),
+      Status::FileWriteError);
+  EXPECT_EQ(chunks, 1);
+}
+
+TEST(BlockDecoderTest, ReportsTruncatedInput) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(100000, 30000, expected, 4);
+  packed.resize(packed.size() / 2);
+
+  BlockDecoder decoder(packed, expected.size());
+  EXPECT_NE(decoder.stream([](std::span<const uint8_t>) { return Status::Ok; }), Status::Ok);
+}
+
+}  // namespace
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <utility>
+
+/**
+ * @brief Blocking FIFO queue with a fixed capacity, to hand work between two threads.
+ *
+ * A producer that gets ahead of its consumer waits in `push()` instead of growing the queue.
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  /**
+   * @brief Constructs a new BoundedQueue.
+   * @param capacity Most items the queue holds, at least 1.
+   */
+  explicit BoundedQueue(size_t capacity) : capacity_{capacity} {}
+
+  BoundedQueue(const BoundedQueue&)            = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  /**
+   * @brief Appends an item, waiting while the queue is full.
+   * @param item The item to append.
+   */
+  void push(T item) {
+    {
+      std::unique_lock lock(mutex_);
+      not_full_.wait(lock, [this]() { return items_.size() < capacity_; });
+      items_.push_back(std::move(item));
+    }
+    not_empty_.notify_one();
+  }
+
+  /**
+   * @brief Removes the oldest item, waiting while the queue is empty.
+   * @return The oldest item.
+   */
+  T pop() {
+    T item;
+    {
+      std::unique_lock lock(mutex_);
+      not_empty_.wait(lock, [this]() { return !items_.empty(); });
+      item = std::move(items_.front());
+      items_.pop_front();
+    }
+    not_full_.notify_one();
+    return item;
+  }
+
+  /**
+   * @brief Checks whether the queue is empty.
+   *
+   * The answer may be stale by the time it is used; it is meant as a hint, e.g. whether the
+   * consumer has a backlog.
+   *
+   * @return True if no item is queued.
+   */
+  bool empty() const {
+    std::lock_guard lock(mutex_);
+    return items_.empty();
+  }
+
+ private:
+  size_t                  capacity_;
+  mutable std::mutex      mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+  std::deque<T>           items_;
+};
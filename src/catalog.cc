@@ -0,0 +1,204 @@
+#include "catalog.hh"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <system_error>
+
+#include "archive_index.hh"
+#include "unlzx.hh"
+
+namespace {
+
+// Start of a catalog file; the archive records, entry records, name index and strings follow.
+struct CatalogHeader {
+  char     magic[4];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t reserved;
+  uint64_t archives;
+  uint64_t entries;
+  uint64_t strings;
+};
+
+constexpr char     kMagic[4]  = {'L', 'Z', 'X', 'C'};
+constexpr uint32_t kVersion   = 1;
+constexpr uint32_t kByteOrder = 0x01020304;
+
+template <typename Column>
+bool write_column(std::ofstream& file, const Column& column) {
+  return static_cast<bool>(file.write(reinterpret_cast<const char*>(column.data()),
+      static_cast<std::streamsize>(column.size() * sizeof(column[0]))));
+}
+
+}  // namespace
+
+Status Catalog::build(std::span<const std::filesystem::path> archives, ThreadPool& pool,
+    const std::filesystem::path& path) {
+  // Each archive is scanned into its own records, with name offsets into its own names.
+  struct Scan {
+    Status                   status = Status::Ok;
+    std::string              names;
+    std::vector<EntryRecord> entries;
+  };
+  std::vector<Scan> scans(archives.size());
+
+  for (size_t index = 0; index < archives.size(); ++index) {
+    pool.submit([&scan = scans[index], &filename = archives[index], index]() {
+      Unlzx unlzx;
+      scan.status = unlzx.open_archive(filename.string().c_str());
+      if (scan.status != Status::Ok) return;
+
+      std::unique_ptr<ArchiveIndex> archive;
+      scan.status = unlzx.index_archive(archive);
+      for (size_t entry = 0; entry < archive->size(); ++entry) {
+        auto& record       = scan.entries.emplace_back();
+        record.name_offset = scan.names.size();
+        record.archive     = static_cast<uint32_t>(index);
+        record.header      = archive->header(entry);
+        scan.names += archive->name(entry);
+      }
+    });
+  }
+  pool.wait();
+
+  // Records are value-initialized and then filled in, so their padding is written as zeros.
+  std::string                strings;
+  std::vector<ArchiveRecord> archive_records;
+  std::vector<EntryRecord>   entry_records;
+  for (size_t index = 0; index < archives.size(); ++index) {
+    std::string filename = archives[index].string();
+    auto&       archive  = archive_records.emplace_back();
+    archive.path_offset  = strings.size();
+    archive.path_length  = static_cast<uint32_t>(filename.size());
+    archive.status       = static_cast<uint32_t>(scans[index].status);
+    strings += filename;
+
+    for (const auto& scanned : scans[index].entries) {
+      auto& record       = entry_records.emplace_back();
+      record.name_offset = strings.size() + scanned.name_offset;
+      record.archive     = scanned.archive;
+      record.header      = scanned.header;
+    }
+    strings += scans[index].names;
+    scans[index] = {};
+  }
+
+  auto name_of = [&](uint32_t entry) {
+    const auto& record = entry_records[entry];
+    return std::string_view(strings).substr(record.name_offset, record.header.filename_length());
+  };
+  std::vector<uint32_t> by_name(entry_records.size());
+  for (uint32_t entry = 0; entry < by_name.size(); ++entry) by_name[entry] = entry;
+  std::stable_sort(by_name.begin(), by_name.end(),
+      [&name_of](uint32_t left, uint32_t right) { return name_of(left) < name_of(right); });
+
+  CatalogHeader header{};
+  std::copy(std::begin(kMagic), std::end(kMagic), header.magic);
+  header.version    = kVersion;
+  header.byte_order = kByteOrder;
+  header.archives   = archive_records.size();
+  header.entries    = entry_records.size();
+  header.strings    = strings.size();
+
+  // Written next to the final path and renamed into place, so readers never see a partial file.
+  auto temporary = path;
+  temporary += ".tmp";
+  {
+    std::ofstream file(temporary, std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!file) return Status::FileCreateError;
+    bool written = file.write(reinterpret_cast<const char*>(&header), sizeof(header)) &&
+                   write_column(file, archive_records) && write_column(file, entry_records) &&
+                   write_column(file, by_name) && write_column(file, strings) && file.flush();
+    if (!written) {
+      file.close();
+      std::error_code ignored;
+      std::filesystem::remove(temporary, ignored);
+      return Status::FileWriteError;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(temporary, path, error);
+  if (error) {
+    std::filesystem::remove(temporary, error);
+    return Status::FileWriteError;
+  }
+  return Status::Ok;
+}
+
+Status Catalog::open(const std::filesystem::path& path, std::unique_ptr<Catalog>& out) {
+  std::unique_ptr<Catalog> catalog(new Catalog());
+  TRY(MmapInputBuffer::for_file(path.string().c_str(), catalog->mapping_));
+  InputBuffer buffer = catalog->mapping_->get();
+
+  CatalogHeader header;
+  if (buffer.read_into(&header, sizeof(header)) != Status::Ok) return Status::NotLzxFile;
+  if (!std::equal(std::begin(kMagic), std::end(kMagic), header.magic) ||
+      header.version != kVersion || header.byte_order != kByteOrder) {
+    return Status::NotLzxFile;
+  }
+
+  // The sections must fill the file exactly. Each record size is a multiple of the alignment of
+  // the next section, so the mapping can be read in place.
+  static_assert(sizeof(CatalogHeader) % alignof(ArchiveRecord) == 0);
+  static_assert(sizeof(ArchiveRecord) % alignof(EntryRecord) == 0);
+  static_assert(sizeof(EntryRecord) % alignof(uint32_t) == 0);
+  size_t available = buffer.available();
+  if (header.archives > available / sizeof(ArchiveRecord) ||
+      header.entries > available / (sizeof(EntryRecord) + sizeof(uint32_t)) ||
+      header.archives * sizeof(ArchiveRecord) +
+              header.entries * (sizeof(EntryRecord) + sizeof(uint32_t)) + header.strings !=
+          available) {
+    return Status::NotLzxFile;
+  }
+
+  std::span<const uint8_t> section;
+  TRY(buffer.read_span(header.archives * sizeof(ArchiveRecord), section));
+  catalog->archives_ = {reinterpret_cast<const ArchiveRecord*>(section.data()), header.archives};
+  TRY(buffer.read_span(header.entries * sizeof(EntryRecord), section));
+  catalog->entries_ = {reinterpret_cast<const EntryRecord*>(section.data()), header.entries};
+  TRY(buffer.read_span(header.entries * sizeof(uint32_t), section));
+  catalog->by_name_ = {reinterpret_cast<const uint32_t*>(section.data()), header.entries};
+  TRY(buffer.read_span(header.strings, section));
+  catalog->strings_ = {reinterpret_cast<const char*>(section.data()), section.size()};
+
+  out = std::move(catalog);
+  return Status::Ok;
+}
+
+// Records are not checked when opening, so that opening stays independent of the catalog size.
+// Each accessor checks the indices and string offsets it reads instead.
+std::string_view Catalog::archive(size_t archive) const {
+  if (archive >= archives_.size()) return {};
+  const auto& record = archives_[archive];
+  if (record.path_offset > strings_.size()) return {};
+  return strings_.substr(record.path_offset, record.path_length);
+}
+
+std::string_view Catalog::name(size_t entry) const {
+  if (entry >= entries_.size()) return {};
+  const auto& record = entries_[entry];
+  if (record.name_offset > strings_.size()) return {};
+  return strings_.substr(record.name_offset, record.header.filename_length());
+}
+
+const lzx::Header& Catalog::header(size_t entry) const {
+  static const lzx::Header kEmpty{};
+  if (entry >= entries_.size()) return kEmpty;
+  return entries_[entry].header;
+}
+
+uint32_t Catalog::archive_of(size_t entry) const {
+  if (entry >= entries_.size() || entries_[entry].archive >= archives_.size()) return kNoArchive;
+  return entries_[entry].archive;
+}
+
+std::span<const uint32_t> Catalog::find(std::string_view name) const {
+  auto first = std::lower_bound(by_name_.begin(), by_name_.end(), name,
+      [this](uint32_t entry, std::string_view name) { return this->name(entry) < name; });
+  auto last = std::upper_bound(first, by_name_.end(), name,
+      [this](std::string_view name, uint32_t entry) { return name < this->name(entry); });
+  return {first, last};
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "error.hh"
+#include "lzx_handle.hh"
+#include "mmap_buffer.hh"
+#include "thread_pool.hh"
+
+/**
+ * @brief Read-only catalog of the entries of many archives, answering "which archive holds this
+ *        file" without opening any archive.
+ *
+ * `build()` scans the archives in parallel and writes one file: per-archive and per-entry records,
+ * a name-sorted permutation of the entries and a string table. `open()` maps that file, and every
+ * accessor reads from the mapping in place, so opening and lookups do no per-entry work. The file
+ * is meant for this machine only: it uses the native byte order.
+ *
+ * Since `open()` does not check the records, a damaged catalog may hold indices out of range, for
+ * example in `by_name()`. Every accessor accepts them and returns an empty value instead.
+ */
+class Catalog {
+ public:
+  /// Archive of an entry whose record is damaged.
+  static constexpr uint32_t kNoArchive = ~uint32_t{0};
+
+  /**
+   * @brief Catalogs the entries of several archives.
+   *
+   * An archive that cannot be opened is recorded with its status and no entries. Entries read
+   * before an error ends an archive's listing are kept, as in `ArchiveIndex::from_buffer()`.
+   *
+   * @param archives The paths to the LZX archive files.
+   * @param pool The pool to scan on; must not be used concurrently by others.
+   * @param path The path to write the catalog to.
+   * @return Status::Ok, or the error writing the catalog.
+   */
+  static Status build(std::span<const std::filesystem::path> archives, ThreadPool& pool,
+      const std::filesystem::path& path);
+
+  /**
+   * @brief Maps a catalog written by `build()`.
+   * @param path The path to the catalog.
+   * @param out The catalog.
+   * @return Status::Ok, a file error, or Status::NotLzxFile if the file is not a catalog.
+   */
+  static Status open(const std::filesystem::path& path, std::unique_ptr<Catalog>& out);
+
+  /**
+   * @brief Gets the number of archives.
+   * @return The number of archives given to `build()`.
+   */
+  size_t archive_count() const { return archives_.size(); }
+
+  /**
+   * @brief Gets the path of an archive.
+   * @param archive The archive, in the order given to `build()`.
+   * @return The path, as given to `build()`; empty if there is no such archive.
+   */
+  std::string_view archive(size_t archive) const;
+
+  /**
+   * @brief Gets the status of scanning an archive.
+   * @param archive The archive, in the order given to `build()`.
+   * @return Status::Ok if every header was read, otherwise the error that ended the scan;
+   *         Status::OutOfRange if there is no such archive.
+   */
+  Status archive_status(size_t archive) const {
+    if (archive >= archives_.size()) return Status::OutOfRange;
+    return static_cast<Status>(archives_[archive].status);
+  }
+
+  /**
+   * @brief Gets the number of entries.
+   * @return The number of entries of all archives, including repeated names.
+   */
+  size_t size() const { return entries_.size(); }
+
+  /**
+   * @brief Gets the name of an entry.
+   * @param entry The entry, in archive order.
+   * @return The name, as stored in the archive; empty if there is no such entry.
+   */
+  std::string_view name(size_t entry) const;
+
+  /**
+   * @brief Gets the header of an entry, with its sizes, data CRC-32, datestamp and attributes.
+   * @param entry The entry, in archive order.
+   * @return The header, as stored in the archive; all zero if there is no such entry.
+   */
+  const lzx::Header& header(size_t entry) const;
+
+  /**
+   * @brief Gets the archive holding an entry.
+   * @param entry The entry, in archive order.
+   * @return The archive index, or kNoArchive if there is no such entry or archive.
+   */
+  uint32_t archive_of(size_t entry) const;
+
+  /**
+   * @brief Gets the entries sorted by name, ties in archive order.
+   * @return The entry indices.
+   */
+  std::span<const uint32_t> by_name() const { return by_name_; }
+
+  /**
+   * @brief Finds the entries with a name.
+   * @param name The name, as stored in the archive.
+   * @return The matching entries, in archive order; empty if there are none.
+   */
+  std::span<const uint32_t> find(std::string_view name) const;
+
+ private:
+  // Records as stored in the file.
+  struct ArchiveRecord {
+    uint64_t path_offset;
+    uint32_t path_length;
+    uint32_t status;
+  };
+
+  struct EntryRecord {
+    uint64_t    name_offset;
+    uint32_t    archive;
+    lzx::Header header;
+  };
+
+  Catalog() = default;
+
+  std::unique_ptr<MmapInputBuffer> mapping_;
+  std::span<const ArchiveRecord>   archives_;
+  std::span<const EntryRecord>     entries_;
+  std::span<const uint32_t>        by_name_;
+  std::string_view                 strings_;
+};
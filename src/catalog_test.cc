@@ -0,0 +1,121 @@
+#include "catalog.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "crc.hh"
+#include "test_archive.hh"
+
+namespace {
+
+class CatalogTest : public ArchiveTest {
+ protected:
+  std::filesystem::path write_archive(const std::string& name, const TestArchive& archive) {
+    auto path = root_ / name;
+    std::ofstream out(path, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(archive.bytes().data()),
+        static_cast<std::streamsize>(archive.bytes().size()));
+    return path;
+  }
+};
+
+TEST_F(CatalogTest, FindsEntriesAcrossArchives) {
+  std::vector<std::filesystem::path> archives;
+  for (size_t index = 0; index < 3; ++index) {
+    TestArchive archive;
+    archive.add_block({{"common", pattern(100 + index, 1)}});
+    archive.add_block({{"only" + std::to_string(index), pattern(50, 2)}, {"dir/merged", pattern(70, 3)}});
+    archives.push_back(write_archive("archive" + std::to_string(index) + ".lzx", archive));
+  }
+  archives.push_back(root_ / "missing.lzx");
+
+  ThreadPool pool(2);
+  auto       path = root_ / "corpus.cat";
+  ASSERT_EQ(Catalog::build(archives, pool, path), Status::Ok);
+
+  std::unique_ptr<Catalog> catalog;
+  ASSERT_EQ(Catalog::open(path, catalog), Status::Ok);
+  ASSERT_EQ(catalog->archive_count(), 4U);
+  EXPECT_EQ(catalog->size(), 9U);
+  EXPECT_EQ(catalog->archive(1), archives[1].string());
+  EXPECT_EQ(catalog->archive_status(0), Status::Ok);
+  EXPECT_EQ(catalog->archive_status(3), Status::FileOpenError);
+
+  auto common = catalog->find("common");
+  ASSERT_EQ(common.size(), 3U);
+  for (size_t index = 0; index < common.size(); ++index) {
+    EXPECT_EQ(catalog->archive_of(common[index]), index);
+    EXPECT_EQ(catalog->header(common[index]).unpack_size(), 100 + index);
+
+    auto       data = pattern(100 + index, 1);
+    crc::Crc32 crc;
+    crc.calc(data.data(), data.size());
+    EXPECT_EQ(catalog->header(common[index]).data_crc(), crc.sum());
+  }
+
+  auto only = catalog->find("only2");
+  ASSERT_EQ(only.size(), 1U);
+  EXPECT_EQ(catalog->archive_of(only[0]), 2U);
+  EXPECT_EQ(catalog->name(only[0]), "only2");
+  EXPECT_EQ(catalog->find("dir/merged").size(), 3U);
+  EXPECT_TRUE(catalog->find("only").empty());
+  EXPECT_TRUE(catalog->find("zzz").empty());
+
+  std::vector<std::string> sorted;
+  for (uint32_t entry : catalog->by_name()) sorted.emplace_back(catalog->name(entry));
+  EXPECT_TRUE(std::is_sorted(sorted.begin(), sorted.end()));
+}
+
+TEST_F(CatalogTest, ToleratesDamagedRecords) {
+  TestArchive archive;
+  archive.add_block({{"a", pattern(10, 1)}, {"b", pattern(20, 2)}});
+  std::vector<std::filesystem::path> archives = {write_archive("archive.lzx", archive)};
+
+  ThreadPool pool(1);
+  auto       path = root_ / "corpus.cat";
+  ASSERT_EQ(Catalog::build(archives, pool, path), Status::Ok);
+
+  // After the 40-byte header: one 16-byte archive record, two 48-byte entry records holding
+  // their archive at offset 8, and the name index.
+  auto bytes = read_file(path);
+  ASSERT_EQ(bytes.size(), 40 + 16 + 2 * 48 + 2 * 4 + archives[0].string().size() + 2);
+  for (size_t record = 0; record < 2; ++record) {
+    auto padding = bytes.begin() + 40 + 16 + record * 48 + 12 + sizeof(lzx::Header);
+    EXPECT_TRUE(std::all_of(padding, padding + 5, [](uint8_t byte) { return byte == 0; }));
+  }
+  uint32_t bad_archive = 7;
+  uint32_t bad_entry   = 1000;
+  std::copy_n(reinterpret_cast<const uint8_t*>(&bad_archive), 4, bytes.begin() + 40 + 16 + 8);
+  std::copy_n(reinterpret_cast<const uint8_t*>(&bad_entry), 4, bytes.begin() + 40 + 16 + 2 * 48);
+  {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  }
+
+  std::unique_ptr<Catalog> catalog;
+  ASSERT_EQ(Catalog::open(path, catalog), Status::Ok);
+  EXPECT_EQ(catalog->archive_of(0), Catalog::kNoArchive);
+  EXPECT_TRUE(catalog->archive(catalog->archive_of(0)).empty());
+  EXPECT_EQ(catalog->archive_status(Catalog::kNoArchive), Status::OutOfRange);
+  EXPECT_EQ(catalog->archive_of(1), 0U);
+  EXPECT_EQ(catalog->by_name()[0], bad_entry);
+  EXPECT_TRUE(catalog->name(bad_entry).empty());
+  EXPECT_EQ(catalog->header(bad_entry).unpack_size(), 0U);
+  EXPECT_TRUE(catalog->find("a").empty());
+}
+
+TEST_F(CatalogTest, RejectsOtherFiles) {
+  TestArchive archive;
+  archive.add_block({{"file", pattern(10, 1)}});
+  auto path = write_archive("archive.lzx", archive);
+
+  std::unique_ptr<Catalog> catalog;
+  EXPECT_EQ(Catalog::open(path, catalog), Status::NotLzxFile);
+  EXPECT_EQ(Catalog::open(root_ / "missing.cat", catalog), Status::FileOpenError);
+}
+
+}  // namespace
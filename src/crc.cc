@@ -4,6 +4,19 @@
 #include <array>
 #include <cstddef>
 #include <cstdint>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CRC_HAS_PCLMUL 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define TARGET_PCLMUL
+#else
+#include <cpuid.h>
+#define TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#endif
+#endif
 
 namespace crc {
 namespace {
@@ -54,12 +67,209 @@ constexpr std::array<uint32_t, 256> generate_lookup_table() {
 /// The CRC32 lookup table.
 constexpr std::array<uint32_t, 256> crc_table = generate_lookup_table();
 
+/// Number of bytes consumed per step by the sliced loop.
+constexpr size_t kSlices = 16;
+
+/// Generate the slicing-by-16 tables.
+///
+/// Table `k` holds the CRC of each byte value followed by `k` zero bytes, so that the CRCs of 16
+/// consecutive bytes can be looked up independently and combined with XOR.
+///
+/// @return A constexpr std::array of 16 tables of 256 CRC32 values.
+///
+constexpr std::array<std::array<uint32_t, 256>, kSlices> generate_slice_tables() {
+  std::array<std::array<uint32_t, 256>, kSlices> tables{};
+
+  tables[0] = generate_lookup_table();
+  for (size_t slice = 1; slice < kSlices; ++slice) {
+    for (size_t index = 0; index < 256; ++index) {
+      uint32_t previous    = tables[slice - 1][index];
+      tables[slice][index] = (previous >> 8) ^ tables[0][previous & 255];
+    }
+  }
+
+  return tables;
+}
+
+/// The slicing-by-16 lookup tables.
+constexpr std::array<std::array<uint32_t, 256>, kSlices> slice_tables = generate_slice_tables();
+static_assert(slice_tables[0][1] == crc_table[1]);
+
+/// Update a pre-inverted CRC with the slicing-by-16 loop.
+uint32_t crc_slicing_by_16(uint32_t temp, const uint8_t* memory, size_t length) {
+  // The running CRC is folded into the first four bytes of each 16-byte step. Bytes are combined
+  // individually, so the loop is independent of host endianness.
+  for (; length >= kSlices; length -= kSlices, memory += kSlices) {
+    uint32_t first = temp ^ (static_cast<uint32_t>(memory[0]) | (memory[1] << 8) |
+                                (memory[2] << 16) | (static_cast<uint32_t>(memory[3]) << 24));
+    temp = slice_tables[15][first & 255] ^ slice_tables[14][(first >> 8) & 255] ^
+           slice_tables[13][(first >> 16) & 255] ^ slice_tables[12][first >> 24] ^
+           slice_tables[11][memory[4]] ^ slice_tables[10][memory[5]] ^ slice_tables[9][memory[6]] ^
+           slice_tables[8][memory[7]] ^ slice_tables[7][memory[8]] ^ slice_tables[6][memory[9]] ^
+           slice_tables[5][memory[10]] ^ slice_tables[4][memory[11]] ^ slice_tables[3][memory[12]] ^
+           slice_tables[2][memory[13]] ^ slice_tables[1][memory[14]] ^ slice_tables[0][memory[15]];
+  }
+
+  for (size_t i = 0; i < length; ++i) {
+    temp = crc_table[(memory[i] ^ temp) & 255] ^ (temp >> 8);
+  }
+  return temp;
+}
+
+#ifdef CRC_HAS_PCLMUL
+/// Smallest input the folding kernel accepts.
+constexpr size_t kPclmulMinLength = 64;
+
+/// Load 16 unaligned bytes.
+TARGET_PCLMUL inline __m128i load(const uint8_t* memory) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(memory));
+}
+
+/// Fold 128 bits of remainder forward by the distance `constants` were computed for, onto `next`.
+TARGET_PCLMUL inline __m128i fold(__m128i value, __m128i constants, __m128i next) {
+  __m128i low  = _mm_clmulepi64_si128(value, constants, 0x00);
+  __m128i high = _mm_clmulepi64_si128(value, constants, 0x11);
+  return _mm_xor_si128(_mm_xor_si128(low, high), next);
+}
+
+/// Update a pre-inverted CRC by folding 64 bytes per step with carry-less multiplication.
+///
+/// The constants are x^n mod P(x), bit-reflected, for the fold distances of 512+64, 512, 128+64
+/// and 128 bits, plus the Barrett reduction constants, as described in Intel's "Fast CRC
+/// Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+///
+/// @param length At least `kPclmulMinLength` and a multiple of 16.
+///
+TARGET_PCLMUL uint32_t crc_pclmul(uint32_t temp, const uint8_t* memory, size_t length) {
+  const __m128i k1k2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+  const __m128i k3k4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+  const __m128i k5k0 = _mm_set_epi64x(0, 0x0163cd6124);
+  const __m128i poly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+  const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+
+  __m128i x1 = _mm_xor_si128(load(memory), _mm_cvtsi32_si128(static_cast<int>(temp)));
+  __m128i x2 = load(memory + 16);
+  __m128i x3 = load(memory + 32);
+  __m128i x4 = load(memory + 48);
+  memory += 64;
+  length -= 64;
+
+  // Four independent folds of 16 bytes each.
+  for (; length >= 64; length -= 64, memory += 64) {
+    x1 = fold(x1, k1k2, load(memory));
+    x2 = fold(x2, k1k2, load(memory + 16));
+    x3 = fold(x3, k1k2, load(memory + 32));
+    x4 = fold(x4, k1k2, load(memory + 48));
+  }
+
+  // Fold into 128 bits, then through any 16-byte blocks left.
+  x1 = fold(x1, k3k4, x2);
+  x1 = fold(x1, k3k4, x3);
+  x1 = fold(x1, k3k4, x4);
+  for (; length >= 16; length -= 16, memory += 16) {
+    x1 = fold(x1, k3k4, load(memory));
+  }
+
+  // Fold 128 bits to 64.
+  x2 = _mm_clmulepi64_si128(x1, k3k4, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), x2);
+  x2 = _mm_srli_si128(x1, 4);
+  x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k5k0, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+
+  // Barrett reduction to 32 bits.
+  x2 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), poly, 0x10);
+  x2 = _mm_clmulepi64_si128(_mm_and_si128(x2, mask), poly, 0x00);
+  x1 = _mm_xor_si128(x1, x2);
+  return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+/// Check CPUID for PCLMULQDQ and SSE4.1.
+bool has_pclmul() {
+  constexpr uint32_t kPclmulBit = 1U << 1;
+  constexpr uint32_t kSse41Bit  = 1U << 19;
+#ifdef _MSC_VER
+  int registers[4];
+  __cpuid(registers, 1);
+  uint32_t ecx = static_cast<uint32_t>(registers[2]);
+#else
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) return false;
+#endif
+  return (ecx & kPclmulBit) != 0 && (ecx & kSse41Bit) != 0;
+}
+#endif
+
+/// Multiply two polynomials modulo the CRC32 polynomial, both bit-reflected: x^0 is bit 31.
+constexpr uint32_t multiply_mod_p(uint32_t a, uint32_t b) {
+  uint32_t product = 0;
+  for (uint32_t bit = 1U << 31; bit != 0; bit >>= 1) {
+    if ((a & bit) != 0) product ^= b;
+    b = (b & 1) != 0 ? (b >> 1) ^ kCrc32ReversedPolynomial : b >> 1;
+  }
+  return product;
+}
+
+/// Generate x^(2^n) modulo the CRC32 polynomial, for n in 0..31.
+constexpr std::array<uint32_t, 32> generate_power_table() {
+  std::array<uint32_t, 32> table{};
+
+  uint32_t power = 1U << 30;  // x^1
+  for (auto& entry : table) {
+    entry = power;
+    power = multiply_mod_p(power, power);
+  }
+
+  return table;
+}
+
+/// x^(2^n) modulo the CRC32 polynomial.
+constexpr std::array<uint32_t, 32> power_table = generate_power_table();
+
+/// Compute x^(8 * length) modulo the CRC32 polynomial: the shift appending `length` bytes applies.
+constexpr uint32_t byte_shift_mod_p(size_t length) {
+  uint32_t result = 1U << 31;  // x^0
+  for (size_t n = 3; length != 0; length >>= 1, n++) {
+    if ((length & 1) != 0) result = multiply_mod_p(power_table[n % 32], result);
+  }
+  return result;
+}
+static_assert(byte_shift_mod_p(0) == 1U << 31);
+static_assert(byte_shift_mod_p(1) == power_table[3]);
+
+Kernel select_kernel() {
+#ifdef CRC_HAS_PCLMUL
+  if (has_pclmul()) return Kernel::Pclmul;
+#endif
+  return Kernel::SlicingBy16;
+}
+
 }  // namespace
 
+Kernel active_kernel() {
+  static const Kernel kernel = select_kernel();
+  return kernel;
+}
+
+std::string_view format_kernel(Kernel kernel) {
+  switch (kernel) {
+  case Kernel::SlicingBy16:
+    return "slicing-by-16";
+  case Kernel::Pclmul:
+    return "pclmulqdq";
+  }
+  return "unknown";
+}
+
 auto Crc32::sum() const -> uint32_t {
   return sum_;
 }
 
+auto Crc32::combine(uint32_t chunk_sum, size_t chunk_length) -> uint32_t {
+  sum_ = crc32_combine(sum_, chunk_sum, chunk_length);
+  return sum_;
+}
+
 auto Crc32::calc(const void* memory_raw, size_t length) -> uint32_t {
   const uint8_t* memory = static_cast<const uint8_t*>(memory_raw);
 
@@ -68,10 +278,51 @@ auto Crc32::calc(const void* memory_raw, size_t length) -> uint32_t {
   }
 
   uint32_t temp = ~sum_;
-  for (size_t i = 0; i < length; ++i) {
-    temp = crc_table[(memory[i] ^ temp) & 255] ^ (temp >> 8);
+
+#ifdef CRC_HAS_PCLMUL
+  if (length >= kPclmulMinLength && active_kernel() == Kernel::Pclmul) {
+    size_t folded = length & ~size_t{15};
+    temp          = crc_pclmul(temp, memory, folded);
+    memory += folded;
+    length -= folded;
   }
+#endif
+
+  temp = crc_slicing_by_16(temp, memory, length);
   sum_ = ~temp;
   return sum_;
 }
+
+size_t SegmentCrc32::add_segment(size_t offset, size_t length) {
+  segments_.push_back({offset, length, Crc32()});
+  return segments_.size() - 1;
+}
+
+void SegmentCrc32::update(size_t offset, std::span<const uint8_t> data) {
+  size_t end = offset + data.size();
+  for (auto& segment : segments_) {
+    size_t begin_overlap = std::max(offset, segment.offset);
+    size_t end_overlap   = std::min(end, segment.offset + segment.length);
+    if (begin_overlap < end_overlap) {
+      segment.crc.calc(data.data() + (begin_overlap - offset), end_overlap - begin_overlap);
+    }
+  }
+}
+
+uint32_t SegmentCrc32::sum(size_t index) const {
+  return segments_[index].crc.sum();
+}
+
+void SegmentCrc32::reset() {
+  for (auto& segment : segments_) {
+    segment.crc = Crc32();
+  }
+}
+
+// Appending `length` bytes to the first chunk multiplies its CRC by x^(8 * length); the pre- and
+// post-conditioning inversions cancel out in the XOR with the second CRC.
+uint32_t crc32_combine(uint32_t first_sum, uint32_t second_sum, size_t second_length) {
+  return multiply_mod_p(byte_shift_mod_p(second_length), first_sum) ^ second_sum;
+}
+
 }  // namespace crc
@@ -2,8 +2,34 @@
 
 #include <cstddef>
 #include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
 
 namespace crc {
+
+/**
+ * @brief CRC-32 implementations `Crc32::calc()` can run.
+ */
+enum class Kernel {
+  SlicingBy16,  ///< Portable table-driven loop, 16 bytes per step.
+  Pclmul,       ///< x86-64 folding with carry-less multiplication (PCLMULQDQ).
+};
+
+/**
+ * @brief Gets the kernel selected for this CPU.
+ *
+ * The selection is made once, on first use, from the CPUID feature flags.
+ *
+ * @return The kernel `Crc32::calc()` uses for large inputs.
+ */
+Kernel active_kernel();
+
+/**
+ * @brief Returns a string representation of the given kernel.
+ */
+std::string_view format_kernel(Kernel kernel);
+
 class Crc32 {
  public:
   /**
@@ -25,7 +51,78 @@ class Crc32 {
    */
   uint32_t sum() const;
 
+  /**
+   * @brief Appends a chunk whose CRC-32 is already known, without reading its data.
+   * @param chunk_sum The CRC-32 of the chunk, as returned by `sum()` for it alone.
+   * @param chunk_length Length of the chunk in bytes.
+   * @return The CRC-32 of the data so far followed by the chunk.
+   */
+  uint32_t combine(uint32_t chunk_sum, size_t chunk_length);
+
  private:
   uint32_t sum_ = 0;
 };
+
+/**
+ * @brief Running CRC-32s of several ranges of a stream, e.g. the files of a merged block.
+ *
+ * The stream is fed in order, in chunks of any size; each chunk updates the ranges it overlaps.
+ */
+class SegmentCrc32 {
+ public:
+  /**
+   * @brief Adds a range to track.
+   * @param offset Stream offset of the first byte of the range.
+   * @param length Length of the range in bytes.
+   * @return The index of the range, for `sum()`.
+   */
+  size_t add_segment(size_t offset, size_t length);
+
+  /**
+   * @brief Feeds the next chunk of the stream.
+   * @param offset Stream offset of the chunk; the end of the previous chunk, or 0 for the first.
+   * @param data The chunk.
+   */
+  void update(size_t offset, std::span<const uint8_t> data);
+
+  /**
+   * @brief Gets the CRC-32 of a range.
+   * @param index The index returned by `add_segment()`.
+   * @return The CRC-32 of the part of the range fed so far.
+   */
+  uint32_t sum(size_t index) const;
+
+  /**
+   * @brief Gets the end of a range.
+   * @param index The index returned by `add_segment()`.
+   * @return The stream offset just past the range; `sum()` is final once the stream reaches it.
+   */
+  size_t end(size_t index) const {
+    return segments_[index].offset + segments_[index].length;
+  }
+
+  /**
+   * @brief Forgets the data fed so far, keeping the ranges.
+   */
+  void reset();
+
+ private:
+  struct Segment {
+    size_t offset;
+    size_t length;
+    Crc32  crc;
+  };
+
+  std::vector<Segment> segments_;
+};
+
+/**
+ * @brief Computes the CRC-32 of two adjacent chunks from their individual CRC-32s.
+ * @param first_sum The CRC-32 of the first chunk.
+ * @param second_sum The CRC-32 of the second chunk.
+ * @param second_length Length of the second chunk in bytes.
+ * @return The CRC-32 of the first chunk followed by the second.
+ */
+uint32_t crc32_combine(uint32_t first_sum, uint32_t second_sum, size_t second_length);
+
 }  // namespace crc
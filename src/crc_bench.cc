@@ -0,0 +1,46 @@
+// Microbenchmark for crc::Crc32::calc(): throughput of the kernel selected for this CPU, over
+// buffers from cache-resident to memory-bound.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string_view>
+#include <vector>
+
+#include "crc.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+void bench_crc() {
+  std::string_view kernel = crc::format_kernel(crc::active_kernel());
+  std::printf("crc32 kernel: %.*s\n", static_cast<int>(kernel.size()), kernel.data());
+  std::printf("%10s %10s\n", "bytes", "MB/s");
+
+  std::vector<uint8_t> buffer(size_t{64} << 20);
+  for (size_t i = 0; i < buffer.size(); ++i) {
+    buffer[i] = static_cast<uint8_t>(i * 131);
+  }
+
+  volatile uint32_t sink = 0;
+  for (size_t size = 256; size <= buffer.size(); size *= 16) {
+    size_t repeats = std::max<size_t>(4, (size_t{256} << 20) / size);
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < repeats; ++i) {
+      crc::Crc32 crc;
+      sink = crc.calc(buffer.data(), size);
+    }
+    double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    std::printf("%10zu %10.0f\n", size, static_cast<double>(size * repeats) / seconds / 1e6);
+  }
+  (void)sink;
+}
+
+}  // namespace
+
+int main() {
+  bench_crc();
+  return 0;
+}
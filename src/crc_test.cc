@@ -2,6 +2,11 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
 namespace {
 
 TEST(CrcCalcTest, HandlesZeroLength) {
@@ -37,4 +42,118 @@ TEST(CrcCalcTest, HandlesKnownCrcValues) {
   ASSERT_EQ(crc2.sum(), 0x3C4687AF);
 }
 
+TEST(CrcCalcTest, HandlesCheckValue) {
+  const char kCheck[] = "123456789";
+  crc::Crc32 crc;
+  ASSERT_EQ(crc.calc(kCheck, std::strlen(kCheck)), 0xCBF43926);
+}
+
+TEST(CrcCalcTest, MatchesBytewiseCrc) {
+  std::mt19937 rng(1);
+  std::vector<uint8_t> memory(1000);
+  for (auto& byte : memory) byte = static_cast<uint8_t>(rng());
+
+  for (size_t offset = 0; offset < 17; ++offset) {
+    for (size_t length = 0; length + offset <= memory.size(); length += 1 + length / 4) {
+      // Bit-at-a-time reference.
+      uint32_t expected = ~0U;
+      for (size_t i = 0; i < length; ++i) {
+        expected ^= memory[offset + i];
+        for (int bit = 0; bit < 8; ++bit) expected = (expected >> 1) ^ (0xEDB88320 & -(expected & 1));
+      }
+      expected = ~expected;
+
+      crc::Crc32 crc;
+      ASSERT_EQ(crc.calc(memory.data() + offset, length), expected) << offset << " " << length;
+    }
+  }
+}
+
+TEST(CrcCalcTest, AccumulatesAcrossCalls) {
+  std::mt19937 rng(2);
+  std::vector<uint8_t> memory(4096);
+  for (auto& byte : memory) byte = static_cast<uint8_t>(rng());
+
+  crc::Crc32 whole;
+  whole.calc(memory.data(), memory.size());
+
+  crc::Crc32 pieces;
+  for (size_t pos = 0; pos < memory.size();) {
+    size_t length = std::min<size_t>(rng() % 100, memory.size() - pos);
+    pieces.calc(memory.data() + pos, length);
+    pos += length;
+  }
+  ASSERT_EQ(pieces.sum(), whole.sum());
+}
+
+TEST(CrcCombineTest, MatchesSequentialCrc) {
+  std::mt19937 rng(3);
+  std::vector<uint8_t> memory(5000);
+  for (auto& byte : memory) byte = static_cast<uint8_t>(rng());
+
+  crc::Crc32 whole;
+  whole.calc(memory.data(), memory.size());
+
+  for (size_t split : {size_t{0}, size_t{1}, size_t{15}, size_t{64}, size_t{2500}, memory.size()}) {
+    crc::Crc32 first;
+    crc::Crc32 second;
+    first.calc(memory.data(), split);
+    second.calc(memory.data() + split, memory.size() - split);
+
+    EXPECT_EQ(crc::crc32_combine(first.sum(), second.sum(), memory.size() - split), whole.sum());
+    EXPECT_EQ(first.combine(second.sum(), memory.size() - split), whole.sum());
+  }
+}
+
+TEST(CrcCombineTest, CombinesManyChunks) {
+  std::mt19937 rng(4);
+  std::vector<uint8_t> memory(100000);
+  for (auto& byte : memory) byte = static_cast<uint8_t>(rng());
+
+  crc::Crc32 whole;
+  whole.calc(memory.data(), memory.size());
+
+  crc::Crc32 combined;
+  for (size_t pos = 0; pos < memory.size();) {
+    size_t     length = std::min<size_t>(rng() % 3000, memory.size() - pos);
+    crc::Crc32 chunk;
+    chunk.calc(memory.data() + pos, length);
+    combined.combine(chunk.sum(), length);
+    pos += length;
+  }
+  EXPECT_EQ(combined.sum(), whole.sum());
+}
+
+TEST(SegmentCrcTest, SplitsChunksAlongSegments) {
+  std::mt19937 rng(6);
+  std::vector<uint8_t> memory(10000);
+  for (auto& byte : memory) byte = static_cast<uint8_t>(rng());
+
+  // Adjacent segments, one empty, and a gap.
+  const std::pair<size_t, size_t> kSegments[] = {{0, 3000}, {3000, 0}, {3000, 4000}, {8000, 2000}};
+  crc::SegmentCrc32 crcs;
+  for (auto [offset, length] : kSegments) crcs.add_segment(offset, length);
+
+  for (size_t pos = 0; pos < memory.size();) {
+    size_t length = std::min<size_t>(rng() % 1500, memory.size() - pos);
+    crcs.update(pos, std::span<const uint8_t>(memory).subspan(pos, length));
+    pos += length;
+  }
+
+  for (size_t index = 0; index < std::size(kSegments); ++index) {
+    crc::Crc32 expected;
+    expected.calc(memory.data() + kSegments[index].first, kSegments[index].second);
+    EXPECT_EQ(crcs.sum(index), expected.sum()) << index;
+  }
+
+  crcs.reset();
+  EXPECT_EQ(crcs.sum(0), 0);
+}
+
+TEST(CrcKernelTest, ReportsActiveKernel) {
+  crc::Kernel kernel = crc::active_kernel();
+  EXPECT_EQ(crc::active_kernel(), kernel);
+  EXPECT_NE(crc::format_kernel(kernel), "unknown");
+}
+
 }  // namespace
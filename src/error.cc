@@ -30,6 +30,10 @@ std::string_view format_status(Status status) {
     return "Huffman table error";
   case Status::UnknownCompression:
     return "Unknown compression mode";
+  case Status::StaleIndex:
+    return "Stale index";
+  case Status::UnsafePath:
+    return "Unsafe path";
   default:
     return "Unknown error";
   }
@@ -20,6 +20,8 @@ enum class Status {
   ChecksumInvalid,      ///< Data integrity check failed.
   HuffmanTableError,    ///< Huffman table construction or use error.
   UnknownCompression,   ///< Unsupported compression format.
+  StaleIndex,           ///< A saved index does not match its archive.
+  UnsafePath,           ///< A path would escape its destination directory.
 };
 
 /**
@@ -0,0 +1,268 @@
+#include "extract_pipeline.hh"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "bounded_queue.hh"
+#include "crc.hh"
+
+namespace {
+
+// Part of one segment of one entry. A piece without data ends the entry with `status`, or the
+// whole stream if `entry` is kEndOfStream.
+struct Piece {
+  static constexpr size_t kEndOfStream = ~size_t{0};
+
+  size_t                  entry{};
+  size_t                  segment{};
+  size_t                  file_offset{};
+  std::vector<uint8_t>    data;
+  size_t                  length{};
+  std::optional<uint32_t> crc;
+  Status                  status = Status::Ok;
+};
+
+// Where a segment lies in its block and in its file.
+struct Range {
+  size_t block_offset;
+  size_t length;
+  size_t entry;
+  size_t segment;
+  size_t file_offset;
+};
+
+struct FileState {
+  std::unique_ptr<std::ofstream> file;
+  std::vector<crc::Crc32>        crcs;  // One per segment.
+  size_t                         position{};
+  size_t                         remaining{};
+  bool                           done{};
+};
+
+Status create_parent(const std::filesystem::path& path) {
+  if (!path.has_parent_path()) return Status::Ok;
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+  return error ? Status::FileCreateError : Status::Ok;
+}
+
+// Extracts a directory or an empty file, which need no data.
+Status extract_empty(const LzxEntry& entry, const std::filesystem::path& path) {
+  if (entry.name().ends_with("/")) {
+    std::error_code error;
+    std::filesystem::create_directories(path, error);
+    return error ? Status::FileCreateError : Status::Ok;
+  }
+
+  TRY(create_parent(path));
+  std::ofstream out_file(path, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!out_file) return Status::FileCreateError;
+  return entry.metadata().data_crc() == 0 ? Status::Ok : Status::ChecksumInvalid;
+}
+
+class Writer {
+ public:
+  Writer(std::span<const LzxEntry* const> entries, const std::filesystem::path& destination,
+      std::vector<Status>& results,
+      std::vector<FileState>& states, BoundedQueue<Piece>& filled,
+      BoundedQueue<std::vector<uint8_t>>& spare)
+      : entries_(entries), destination_(destination), results_(results), states_(states), filled_(filled), spare_(spare) {}
+
+  void run() {
+    while (true) {
+      Piece piece = filled_.pop();
+      if (piece.entry == Piece::kEndOfStream) return;
+
+      if (piece.data.empty()) {
+        finish(piece.entry, piece.status);
+        continue;
+      }
+      write(piece);
+      spare_.push(std::move(piece.data));
+    }
+  }
+
+ private:
+  void write(const Piece& piece) {
+    FileState& state = states_[piece.entry];
+    if (state.done) return;
+
+    if (!state.file) {
+      auto path = destination_ / entries_[piece.entry]->path();
+      if (create_parent(path) != Status::Ok) return finish(piece.entry, Status::FileCreateError);
+      state.file = std::make_unique<std::ofstream>(
+          path, std::ios::binary | std::ios::out | std::ios::trunc);
+      if (!*state.file) return finish(piece.entry, Status::FileCreateError);
+    }
+
+    // Segments of different blocks may arrive out of order.
+    if (state.position != piece.file_offset) {
+      state.file->seekp(static_cast<std::streamoff>(piece.file_offset));
+      state.position = piece.file_offset;
+    }
+    if (!state.file->write(reinterpret_cast<const char*>(piece.data.data()), piece.length)) {
+      return finish(piece.entry, Status::FileWriteError);
+    }
+    state.position += piece.length;
+
+    crc::Crc32& crc = state.crcs[piece.segment];
+    if (piece.crc) {
+      crc.combine(*piece.crc, piece.length);
+    } else {
+      crc.calc(piece.data.data(), piece.length);
+    }
+
+    state.remaining -= piece.length;
+    if (state.remaining == 0) finish(piece.entry, Status::Ok);
+  }
+
+  void finish(size_t index, Status status) {
+    FileState& state = states_[index];
+    if (state.done) return;
+    state.done = true;
+
+    if (state.file) {
+      state.file->close();
+      if (status == Status::Ok && !*state.file) status = Status::FileWriteError;
+      state.file.reset();
+    }
+
+    if (status == Status::Ok) {
+      const auto& segments = entries_[index]->segments();
+      crc::Crc32  crc;
+      for (size_t segment = 0; segment < segments.size(); ++segment) {
+        crc.combine(state.crcs[segment].sum(), segments[segment].decompressed_length());
+      }
+      if (crc.sum() != entries_[index]->metadata().data_crc()) status = Status::ChecksumInvalid;
+    }
+    results_[index] = status;
+  }
+
+  std::span<const LzxEntry* const>    entries_;
+  const std::filesystem::path&        destination_;
+  std::vector<Status>&                results_;
+  std::vector<FileState>&             states_;
+  BoundedQueue<Piece>&                filled_;
+  BoundedQueue<std::vector<uint8_t>>& spare_;
+};
+
+}  // namespace
+
+std::vector<Status> ExtractPipeline::extract(
+    std::span<const LzxEntry* const> entries, const std::filesystem::path& destination) {
+  std::vector<Status>    results(entries.size(), Status::Ok);
+  std::vector<FileState> states(entries.size());
+
+  // Blocks with the segments they hold, in the order they are stored in the archive.
+  std::vector<std::pair<LzxBlock*, std::vector<Range>>> blocks;
+  std::unordered_map<LzxBlock*, size_t>                 block_index;
+  for (size_t index = 0; index < entries.size(); ++index) {
+    const auto& segments = entries[index]->segments();
+    if (!entries[index]->has_safe_path()) {
+      results[index]     = Status::UnsafePath;
+      states[index].done = true;
+      continue;
+    }
+    if (entries[index]->unpack_size() == 0) {
+      results[index]     = extract_empty(*entries[index], destination / entries[index]->path());
+      states[index].done = true;
+      continue;
+    }
+
+    states[index].crcs.resize(segments.size());
+    states[index].remaining = entries[index]->unpack_size();
+
+    size_t file_offset = 0;
+    for (size_t segment = 0; segment < segments.size(); ++segment) {
+      LzxBlock* block   = segments[segment].block().get();
+      auto [it, is_new] = block_index.try_emplace(block, blocks.size());
+      if (is_new) blocks.emplace_back(block, std::vector<Range>());
+      blocks[it->second].second.push_back({segments[segment].decompressed_offset(),
+          segments[segment].decompressed_length(), index, segment, file_offset});
+      file_offset += segments[segment].decompressed_length();
+    }
+  }
+
+  std::sort(blocks.begin(), blocks.end(),
+      [](const auto& left, const auto& right) { return left.first->index() < right.first->index(); });
+
+  // The filled queue also carries end-of-entry markers, which hold no buffer.
+  BoundedQueue<Piece>                filled(buffers_ + 1);
+  BoundedQueue<std::vector<uint8_t>> spare(buffers_);
+  for (size_t index = 0; index < buffers_; ++index) {
+    spare.push(std::vector<uint8_t>(kBufferSize));
+  }
+
+  Writer      writer(entries, destination, results, states, filled, spare);
+  std::thread writer_thread([&writer]() { writer.run(); });
+
+  for (auto& [block, ranges] : blocks) {
+    std::sort(ranges.begin(), ranges.end(),
+        [](const Range& left, const Range& right) { return left.block_offset < right.block_offset; });
+
+    // Decoding stops after the last selected byte of the block.
+    size_t block_end = 0;
+    for (const Range& range : ranges) block_end = std::max(block_end, range.block_offset + range.length);
+
+    size_t position = 0;  // Block offset of the chunk.
+    size_t first    = 0;  // First range that does not end before the chunk.
+    Status status   = block->stream([&](std::span<const uint8_t> chunk) {
+      size_t chunk_end = position + chunk.size();
+      while (first < ranges.size() && ranges[first].block_offset + ranges[first].length <= position) {
+        ++first;
+      }
+
+      for (size_t index = first; index < ranges.size() && ranges[index].block_offset < chunk_end; ++index) {
+        const Range& range = ranges[index];
+        size_t       begin = std::max(range.block_offset, position);
+        size_t       end   = std::min(range.block_offset + range.length, chunk_end);
+
+        while (begin < end) {
+          Piece piece;
+          piece.entry       = range.entry;
+          piece.segment     = range.segment;
+          piece.file_offset = range.file_offset + (begin - range.block_offset);
+          piece.data        = spare.pop();
+          piece.length      = std::min(end - begin, piece.data.size());
+          std::memcpy(piece.data.data(), chunk.data() + (begin - position), piece.length);
+
+          // A backlog means the writer is the slower side: checksum here rather than there.
+          if (!filled.empty()) {
+            crc::Crc32 crc;
+            piece.crc = crc.calc(piece.data.data(), piece.length);
+          }
+
+          begin += piece.length;
+          filled.push(std::move(piece));
+        }
+      }
+
+      position = chunk_end;
+      return Status::Ok;
+    }, block_end);
+
+    if (status != Status::Ok) {
+      for (const Range& range : ranges) {
+        Piece piece;
+        piece.entry  = range.entry;
+        piece.status = status;
+        filled.push(std::move(piece));
+      }
+    }
+  }
+
+  Piece end;
+  end.entry = Piece::kEndOfStream;
+  filled.push(std::move(end));
+  writer_thread.join();
+
+  return results;
+}
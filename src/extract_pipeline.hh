@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+#include "error.hh"
+#include "lzx_entry.hh"
+
+/**
+ * @brief Extracts entries with decoding and writing overlapped on two threads.
+ *
+ * The calling thread streams each block, in archive order, through the decoder's window and hands
+ * the data to a writer thread in buffers from a fixed pool. When the writer falls behind, the
+ * decoder waits for a buffer to come back, so memory use does not depend on the size of the
+ * blocks. The CRC-32 of each buffer is computed by whichever side has spare cycles: the decoder if
+ * the writer has a backlog, the writer otherwise.
+ */
+class ExtractPipeline {
+ public:
+  /// Size of each buffer passed from the decoder to the writer.
+  static constexpr size_t kBufferSize = size_t{1} << 16;
+
+  /// Default number of buffers in flight.
+  static constexpr size_t kDefaultBufferCount = 16;
+
+  /**
+   * @brief Constructs a new ExtractPipeline.
+   * @param buffers Number of buffers in flight, at least 1.
+   */
+  explicit ExtractPipeline(size_t buffers = kDefaultBufferCount) : buffers_{buffers} {}
+
+  /**
+   * @brief Extracts entries, creating files and directories at their paths.
+   *
+   * Blocks are not retained: an entry whose block was already decompressed with `LzxBlock::data()`
+   * is written from that data, all others are decoded again.
+   *
+   * @param entries The entries to extract.
+   * @param destination Directory the entry paths are relative to; empty for the working directory.
+   * @return The status of each entry, in the same order, as returned by
+   *         `Extractor::extract_entry()`.
+   */
+  std::vector<Status> extract(
+      std::span<const LzxEntry* const> entries, const std::filesystem::path& destination = {});
+
+ private:
+  size_t buffers_;
+};
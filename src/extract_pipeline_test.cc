@@ -0,0 +1,122 @@
+#include "extract_pipeline.hh"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include "test_archive.hh"
+#include "test_encoder.hh"
+
+namespace {
+
+class ExtractPipelineTest : public ArchiveTest {};
+
+TEST_F(ExtractPipelineTest, ExtractsThroughFewBuffers) {
+  std::vector<TestArchive::File> files = {
+      {"large", pattern(5 * ExtractPipeline::kBufferSize + 123, 1)},
+      {"dir/", {}},
+      {"dir/merged_a", pattern(300, 2)},
+      {"dir/merged_b", pattern(0, 3)},
+      {"dir/merged_c", pattern(3 * ExtractPipeline::kBufferSize, 4)},
+      {"dir/merged_d", pattern(1, 5)},
+  };
+  TestArchive archive;
+  archive.add_block({files[0]});
+  archive.add_block({files[1]});
+  archive.add_block({files[2], files[3], files[4], files[5]});
+  auto entries = open(archive);
+  ASSERT_EQ(entries.size(), files.size());
+
+  std::vector<const LzxEntry*> selected;
+  for (const auto& [name, entry] : entries) selected.push_back(&entry);
+
+  auto results = ExtractPipeline(2).extract(selected);
+  ASSERT_EQ(results.size(), selected.size());
+  for (Status status : results) EXPECT_EQ(status, Status::Ok);
+
+  EXPECT_TRUE(std::filesystem::is_directory("dir"));
+  for (const auto& file : files) {
+    if (file.name.ends_with("/")) continue;
+    EXPECT_EQ(read_file(file.name), file.data) << file.name;
+  }
+}
+
+TEST_F(ExtractPipelineTest, ExtractsSelectedFilesOfMergedBlock) {
+  std::vector<TestArchive::File> files = {
+      {"a", pattern(1000, 1)},
+      {"b", pattern(2 * ExtractPipeline::kBufferSize, 2)},
+      {"c", pattern(1000, 3)},
+  };
+  TestArchive archive;
+  archive.add_block(files);
+  auto entries = open(archive);
+
+  const LzxEntry* selected[] = {&entries.at("b")};
+  auto            results    = ExtractPipeline(1).extract(selected);
+  EXPECT_EQ(results[0], Status::Ok);
+  EXPECT_EQ(read_file("b"), files[1].data);
+  EXPECT_FALSE(std::filesystem::exists("a"));
+  EXPECT_FALSE(std::filesystem::exists("c"));
+}
+
+TEST_F(ExtractPipelineTest, ExtractsCompressedMergedBlock) {
+  std::vector<uint8_t> expected;
+  auto packed = test_encoder::encode_random(3 * huffman::BlockDecoder::kStreamBufferSize, 100000, expected, 7);
+
+  // File boundaries inside and across the decoder's chunks.
+  const size_t                   kEnds[] = {1000, huffman::BlockDecoder::kStreamBufferSize + 5, expected.size()};
+  std::vector<TestArchive::File> files;
+  size_t                         offset = 0;
+  for (size_t end : kEnds) {
+    files.push_back({"file" + std::to_string(files.size()),
+        std::vector<uint8_t>(expected.begin() + offset, expected.begin() + end)});
+    offset = end;
+  }
+  TestArchive archive;
+  archive.add_block(files, packed);
+  auto entries = open(archive);
+
+  std::vector<const LzxEntry*> selected;
+  for (const auto& [name, entry] : entries) selected.push_back(&entry);
+
+  for (Status status : ExtractPipeline(3).extract(selected)) EXPECT_EQ(status, Status::Ok);
+  for (const auto& file : files) {
+    EXPECT_EQ(read_file(file.name), file.data) << file.name;
+  }
+}
+
+TEST_F(ExtractPipelineTest, ReportsBadCrc) {
+  TestArchive archive;
+  archive.add_block({{"file", pattern(100, 5)}});
+  auto bytes = archive.bytes();
+  bytes.back() ^= 0xFF;
+
+  auto            entries    = open(bytes);
+  const LzxEntry* selected[] = {&entries.at("file")};
+  EXPECT_EQ(ExtractPipeline().extract(selected)[0], Status::ChecksumInvalid);
+}
+
+TEST_F(ExtractPipelineTest, RejectsPathsOutsideDestination) {
+  TestArchive archive;
+  archive.add_block({{"../escaped", pattern(10, 1)}, {"dir/../../up", pattern(10, 2)},
+      {"/absolute", pattern(10, 3)}, {"dir/..file", pattern(10, 4)}});
+  archive.add_block({{"../empty", {}}});
+  auto entries = open(archive);
+  ASSERT_EQ(entries.size(), 5U);
+
+  const LzxEntry* selected[] = {&entries.at("../escaped"), &entries.at("dir/../../up"),
+      &entries.at("/absolute"), &entries.at("dir/..file"), &entries.at("../empty")};
+  auto results = ExtractPipeline().extract(selected);
+  EXPECT_EQ(results[0], Status::UnsafePath);
+  EXPECT_EQ(results[1], Status::UnsafePath);
+  EXPECT_EQ(results[2], Status::UnsafePath);
+  EXPECT_EQ(results[3], Status::Ok);
+  EXPECT_EQ(results[4], Status::UnsafePath);
+  EXPECT_FALSE(std::filesystem::exists(root_ / "escaped"));
+  EXPECT_FALSE(std::filesystem::exists(root_ / "up"));
+  EXPECT_FALSE(std::filesystem::exists(root_ / "empty"));
+  EXPECT_EQ(read_file("dir/..file"), pattern(10, 4));
+}
+
+}  // namespace
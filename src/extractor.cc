@@ -0,0 +1,153 @@
+#include "extractor.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+
+#include "crc.hh"
+
+Extractor::Extractor(size_t threads)
+    : own_pool_(std::make_unique<ThreadPool>(threads)), pool_(*own_pool_) {}
+
+std::vector<Status> Extractor::extract(
+    std::span<const LzxEntry* const> entries, const std::filesystem::path& destination) {
+  Job job{entries, destination};
+  return std::move(extract(std::span<const Job>(&job, 1)).front());
+}
+
+std::vector<std::vector<Status>> Extractor::extract(std::span<const Job> jobs) {
+  std::vector<std::vector<Status>> results;
+  for (const auto& job : jobs) {
+    results.emplace_back(job.entries.size(), Status::Ok);
+  }
+
+  // Entries of all jobs, as (job, index) pairs.
+  std::vector<std::pair<size_t, size_t>> flat;
+  for (size_t job = 0; job < jobs.size(); ++job) {
+    for (size_t index = 0; index < jobs[job].entries.size(); ++index) {
+      flat.emplace_back(job, index);
+    }
+  }
+
+  // Blocks each entry still waits for, the entries waiting for each block, and how far each block
+  // needs decoding: its last selected byte.
+  std::vector<std::atomic<size_t>>                   remaining(flat.size());
+  std::unordered_map<LzxBlock*, std::vector<size_t>> waiting;
+  std::unordered_map<LzxBlock*, size_t>              block_ends;
+  for (size_t entry = 0; entry < flat.size(); ++entry) {
+    const auto& [job, index] = flat[entry];
+    for (const auto& segment : jobs[job].entries[index]->segments()) {
+      auto& block_end = block_ends[segment.block().get()];
+      block_end = std::max(block_end, segment.decompressed_offset() + segment.decompressed_length());
+
+      auto& waiters = waiting[segment.block().get()];
+      if (!waiters.empty() && waiters.back() == entry) continue;
+      waiters.push_back(entry);
+      remaining[entry].fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  std::vector<std::pair<LzxBlock*, const std::vector<size_t>*>> blocks;
+  blocks.reserve(waiting.size());
+  for (const auto& [block, waiters] : waiting) {
+    blocks.emplace_back(block, &waiters);
+  }
+  std::sort(blocks.begin(), blocks.end(), [](const auto& left, const auto& right) {
+    if (left.first->total_unpacked_size() != right.first->total_unpacked_size()) {
+      return left.first->total_unpacked_size() > right.first->total_unpacked_size();
+    }
+    return left.first->index() < right.first->index();
+  });
+
+  // Entries not yet written for each block, and the blocks of each entry. A block's data is freed
+  // once its last entry is written, so only blocks in flight stay resident.
+  // Blocks are pinned meanwhile, so that a block cache does not evict them under a writer.
+  std::vector<std::atomic<size_t>> users(blocks.size());
+  std::vector<std::vector<size_t>> entry_blocks(flat.size());
+  for (size_t block = 0; block < blocks.size(); ++block) {
+    blocks[block].first->pin();
+    users[block].store(blocks[block].second->size(), std::memory_order_relaxed);
+    for (size_t entry : *blocks[block].second) {
+      entry_blocks[entry].push_back(block);
+    }
+  }
+
+  auto write = [&](size_t entry) {
+    const auto& [job, index] = flat[entry];
+    results[job][index]      = extract_entry(*jobs[job].entries[index], jobs[job].destination);
+
+    for (size_t block : entry_blocks[entry]) {
+      if (users[block].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        blocks[block].first->unpin();
+        blocks[block].first->release();
+      }
+    }
+  };
+
+  for (size_t entry = 0; entry < flat.size(); ++entry) {
+    if (remaining[entry].load(std::memory_order_relaxed) == 0) {
+      pool_.submit([&write, entry]() { write(entry); });
+    }
+  }
+
+  // Tasks run in submission order, so the largest blocks start first. A file completed by a block
+  // is queued on the worker that decoded it, and written next while the data is still in cache.
+  for (const auto& [block, waiters] : blocks) {
+    pool_.submit([&, block, waiters, end = block_ends.at(block)]() {
+      block->data(end);
+      for (size_t entry : *waiters) {
+        if (remaining[entry].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+          pool_.submit([&write, entry]() { write(entry); });
+        }
+      }
+    });
+  }
+
+  pool_.wait();
+  return results;
+}
+
+Status Extractor::extract_entry(const LzxEntry& entry, const std::filesystem::path& destination) {
+  if (!entry.has_safe_path()) return Status::UnsafePath;
+
+  const auto      path = destination / entry.path();
+  std::error_code error;
+
+  if (entry.unpack_size() == 0 && entry.name().ends_with("/")) {
+    std::filesystem::create_directories(path, error);
+    return error ? Status::FileCreateError : Status::Ok;
+  }
+
+  if (path.has_parent_path()) {
+    std::filesystem::create_directories(path.parent_path(), error);
+    if (error) return Status::FileCreateError;
+  }
+
+  std::ofstream out_file(path, std::ios::binary | std::ios::out | std::ios::trunc);
+  if (!out_file) return Status::FileCreateError;
+
+  crc::Crc32 crc_calc;
+  for (const auto& segment : entry.segments()) {
+    // Pinned until written, in case other threads decompress blocks of the same cache.
+    LzxBlock::ScopedPin pin(segment.block().get());
+    auto                data = segment.data();
+    TRY(segment.status());
+
+    // The block computes segment CRCs while decompressing; only fall back to reading the data.
+    if (auto segment_crc = segment.crc()) {
+      crc_calc.combine(*segment_crc, data.size());
+    } else {
+      crc_calc.calc(data.data(), data.size());
+    }
+    if (!out_file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
+      return Status::FileWriteError;
+    }
+  }
+
+  if (entry.metadata().data_crc() != crc_calc.sum()) return Status::ChecksumInvalid;
+  return Status::Ok;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "error.hh"
+#include "lzx_entry.hh"
+#include "thread_pool.hh"
+
+/**
+ * @brief Extracts entries to disk, decoding their blocks concurrently.
+ *
+ * Blocks are independent: each owns its packed data and starts from a fresh decoder state. They
+ * are decoded on a thread pool, largest first so that a long block does not end up running alone
+ * at the end, and each file is written as soon as all of its blocks are decoded. A block's
+ * decompressed data is released once every selected entry using it is written.
+ */
+class Extractor {
+ public:
+  /**
+   * @brief Entries to extract under one destination directory, e.g. those of one archive.
+   */
+  struct Job {
+    std::span<const LzxEntry* const> entries;      ///< The entries to extract.
+    std::filesystem::path            destination;  ///< Directory the entry paths are relative to.
+  };
+
+  /**
+   * @brief Constructs a new Extractor with its own thread pool.
+   * @param threads Number of worker threads; 0 for one per hardware thread.
+   */
+  explicit Extractor(size_t threads = 0);
+
+  /**
+   * @brief Constructs a new Extractor running on a shared thread pool.
+   *
+   * `extract()` waits for the pool to be idle, so it must not run concurrently with other users of
+   * the pool.
+   *
+   * @param pool The pool to run on; must outlive the Extractor.
+   */
+  explicit Extractor(ThreadPool& pool) : pool_(pool) {}
+
+  /**
+   * @brief Extracts entries, creating files and directories at their paths.
+   * @param entries The entries to extract.
+   * @param destination Directory the entry paths are relative to; empty for the working directory.
+   * @return The status of each entry, in the same order, as returned by `extract_entry()`.
+   */
+  std::vector<Status> extract(
+      std::span<const LzxEntry* const> entries, const std::filesystem::path& destination = {});
+
+  /**
+   * @brief Extracts the entries of several jobs, decoding the blocks of all of them together.
+   * @param jobs The jobs to run.
+   * @return For each job, the status of each of its entries, as returned by `extract_entry()`.
+   */
+  std::vector<std::vector<Status>> extract(std::span<const Job> jobs);
+
+  /**
+   * @brief Extracts a single entry on the calling thread, decoding its blocks if needed.
+   * @param entry The entry to extract.
+   * @param destination Directory the entry path is relative to; empty for the working directory.
+   * @return Status indicating success, Status::ChecksumInvalid if the file was written but its
+   *         CRC-32 does not match, Status::UnsafePath if the entry path is absolute or contains
+   *         `..`, or the specific error encountered.
+   */
+  static Status extract_entry(const LzxEntry& entry, const std::filesystem::path& destination = {});
+
+ private:
+  std::unique_ptr<ThreadPool> own_pool_;
+  ThreadPool&                 pool_;
+};
@@ -0,0 +1,108 @@
+#include "extractor.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "test_archive.hh"
+#include "test_encoder.hh"
+
+namespace {
+
+class ExtractorTest : public ArchiveTest {};
+
+TEST_F(ExtractorTest, ExtractsSingleAndMergedBlocks) {
+  std::vector<TestArchive::File> files = {
+      {"single", pattern(5000, 1)},
+      {"dir/merged_a", pattern(300, 2)},
+      {"dir/merged_b", pattern(0, 3)},
+      {"dir/merged_c", pattern(7000, 4)},
+  };
+  TestArchive archive;
+  archive.add_block({files[0]});
+  archive.add_block({files[1], files[2], files[3]});
+  auto entries = open(archive);
+  ASSERT_EQ(entries.size(), files.size());
+
+  std::vector<const LzxEntry*> selected;
+  for (const auto& [name, entry] : entries) selected.push_back(&entry);
+
+  Extractor extractor(3);
+  auto      results = extractor.extract(selected);
+  ASSERT_EQ(results.size(), selected.size());
+  for (Status status : results) EXPECT_EQ(status, Status::Ok);
+
+  for (const auto& file : files) {
+    EXPECT_EQ(read_file(file.name), file.data) << file.name;
+  }
+}
+
+TEST_F(ExtractorTest, ExtractsManyBlocks) {
+  TestArchive                    archive;
+  std::vector<TestArchive::File> files;
+  for (size_t index = 0; index < 64; ++index) {
+    files.push_back({"file" + std::to_string(index), pattern(index * 997 % 20000, static_cast<uint8_t>(index))});
+    archive.add_block({files.back()});
+  }
+  auto entries = open(archive);
+
+  std::vector<const LzxEntry*> selected;
+  for (const auto& [name, entry] : entries) selected.push_back(&entry);
+
+  Extractor extractor(4);
+  for (Status status : extractor.extract(selected)) EXPECT_EQ(status, Status::Ok);
+  for (const auto& file : files) {
+    EXPECT_EQ(read_file(file.name), file.data) << file.name;
+  }
+}
+
+TEST_F(ExtractorTest, ReleasesBlocksButKeepsTheirCrcs) {
+  std::vector<uint8_t> expected;
+  auto                 packed = test_encoder::encode_random(200000, 50000, expected, 9);
+
+  TestArchive archive;
+  archive.add_block({{"a", std::vector<uint8_t>(expected.begin(), expected.begin() + 1000)},
+                        {"b", std::vector<uint8_t>(expected.begin() + 1000, expected.end())}},
+      packed);
+  auto entries = open(archive);
+
+  const LzxEntry* selected[] = {&entries.at("a"), &entries.at("b")};
+  for (Status status : Extractor(2).extract(selected)) EXPECT_EQ(status, Status::Ok);
+
+  // The block was freed after "b"; its CRCs survive and its data decodes again on demand.
+  const auto& segment = entries.at("b").segments().front();
+  EXPECT_TRUE(segment.crc().has_value());
+  auto data = segment.data();
+  EXPECT_TRUE(std::equal(data.begin(), data.end(), expected.begin() + 1000, expected.end()));
+}
+
+TEST_F(ExtractorTest, ReportsBadCrc) {
+  TestArchive archive;
+  archive.add_block({{"file", pattern(100, 5)}});
+  auto bytes = archive.bytes();
+  bytes.back() ^= 0xFF;
+
+  auto entries = open(bytes);
+  ASSERT_EQ(entries.size(), 1U);
+  EXPECT_EQ(Extractor::extract_entry(entries.at("file")), Status::ChecksumInvalid);
+}
+
+TEST_F(ExtractorTest, RejectsPathsOutsideDestination) {
+  TestArchive archive;
+  archive.add_block({{"../escaped", pattern(10, 1)}, {"dir/../../up", pattern(10, 2)},
+      {"/absolute", pattern(10, 3)}, {"dir/..file", pattern(10, 4)}});
+  auto entries = open(archive);
+  ASSERT_EQ(entries.size(), 4U);
+
+  EXPECT_EQ(Extractor::extract_entry(entries.at("../escaped")), Status::UnsafePath);
+  EXPECT_EQ(Extractor::extract_entry(entries.at("dir/../../up")), Status::UnsafePath);
+  EXPECT_EQ(Extractor::extract_entry(entries.at("/absolute")), Status::UnsafePath);
+  EXPECT_EQ(Extractor::extract_entry(entries.at("dir/..file")), Status::Ok);
+  EXPECT_FALSE(std::filesystem::exists(root_ / "escaped"));
+  EXPECT_FALSE(std::filesystem::exists(root_ / "up"));
+  EXPECT_EQ(read_file("dir/..file"), pattern(10, 4));
+}
+
+}  // namespace
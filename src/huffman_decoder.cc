@@ -3,6 +3,8 @@
 #include <algorithm>
 #include <cstdint>
 
+#include "match_copy.hh"
+
 namespace huffman {
 namespace {
 constexpr uint8_t kSymbolBitLengths[32] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8,
@@ -15,143 +17,206 @@ constexpr uint32_t kBaseOffsets[32] = {0, 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48,
 constexpr uint8_t kBaseValues[34] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 0, 1,
     2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
 
+static_assert(HuffmanDecoder::kMaxMatchLength == kBaseOffsets[15] + 3 + (1 << kSymbolBitLengths[15]) - 1);
+
 constexpr uint8_t kSymbolZeroFill          = 17;
 constexpr uint8_t kSymbolRepeatZero        = 18;
 constexpr uint8_t kSymbolRepeatPrevious    = 19;
-constexpr uint8_t kSymbolLongerThanSixBits = 20;
 
 }  // namespace
 
 HuffmanDecoder::HuffmanDecoder()
-    : offsets_(7, 8, 128), huffman20_(6, 20, 96), literals_(12, 768, 5120) {}
+    : offsets_(7, 8), huffman20_(6, 20), literals_(12, 768), literal_pairs_(12) {}
 
-// NOLINTBEGIN(readability-function-cognitive-complexity)
-Status HuffmanDecoder::read_literal_table(InputBuffer* source) {
-  uint32_t symbol;
-  uint32_t pos;
-  uint32_t count;
-  uint32_t fix;
-  uint32_t max_symbol;
-
-  // Read the decrunch method
-  uint16_t method;
-  TRY(source->read_bits(3, method));
-  decrunch_method_ = method;
-
-  // Read and build the offset Huffman table
-  if (decrunch_method_ == 3) {
-    for (auto& bit_length : offsets_.bit_length_) {
-      uint16_t val;
-      TRY(source->read_bits(3, val));
-      bit_length = static_cast<uint8_t>(val);
-    }
-    TRY(offsets_.reset_table());
+HuffmanDecoder::State HuffmanDecoder::save_state() const {
+  return State{literals_.bit_length_, offsets_.bit_length_, decrunch_method_, decrunch_length_,
+      last_offset_};
+}
+
+Status HuffmanDecoder::restore_state(const State& state) {
+  // A table whose lengths are all zero has never been read, and cannot be built.
+  auto is_set = [](const std::vector<uint8_t>& lengths) {
+    return std::any_of(lengths.begin(), lengths.end(), [](uint8_t length) { return length != 0; });
+  };
+
+  offsets_.bit_length_ = state.offset_lengths;
+  if (is_set(offsets_.bit_length_)) TRY(offsets_cache_.reset_table(&offsets_));
+
+  literals_.bit_length_ = state.literal_lengths;
+  literal_pairs_built_      = false;
+  literal_pairs_profitable_ = false;
+  if (is_set(literals_.bit_length_)) {
+    TRY(literals_cache_.reset_table(&literals_));
+    literal_pairs_profitable_ = literal_pairs_.is_profitable(literals_, 256);
+  }
+
+  table_field_       = TableField::Method;
+  decrunch_method_   = state.decrunch_method;
+  decrunch_length_   = state.decrunch_length;
+  last_offset_       = state.last_offset;
+  use_literal_pairs_ = literal_pairs_profitable_ && decrunch_length_ >= kMultiSymbolMinLength;
+  if (use_literal_pairs_) {
+    literal_pairs_.build(literals_, 256);
+    literal_pairs_built_ = true;
   }
+  return Status::Ok;
+}
+
+Status HuffmanDecoder::read_literal_table(BitReader* source) {
+  bool complete = false;
+  TRY(read_literal_table(source, complete));
+  return complete ? Status::Ok : Status::UnexpectedEof;
+}
 
-  // Read decrunch length
-  uint16_t hi_byte;
-  uint16_t mid_byte;
-  uint16_t lo_byte;
-  TRY(source->read_bits(8, hi_byte));
-  TRY(source->read_bits(8, mid_byte));
-  TRY(source->read_bits(8, lo_byte));
-  decrunch_length_ = (hi_byte << 16) | (mid_byte << 8) | lo_byte;
+// Each field is read from a copy of the stream, and only takes effect if the data held all of its
+// bits. A field is at most a few dozen bits long, so a refill always covers it.
+// NOLINTBEGIN(readability-function-cognitive-complexity)
+Status HuffmanDecoder::read_literal_table(BitReader* source, bool& complete) {
+  complete = false;
+
+  BitReader reader;
+  auto      start = [&]() {
+    reader = *source;
+    reader.refill();
+  };
+  auto commit = [&]() {
+    if (reader.overrun()) return false;
+    *source = reader;
+    return true;
+  };
 
   auto fill_literals_bit_lengths = [&](uint32_t byte_count, uint8_t value) {
-    uint32_t fill_length = std::min(byte_count, max_symbol - pos);
-    std::fill_n(literals_.bit_length_.begin() + pos, fill_length, value);
+    uint32_t fill_length = std::min(byte_count, table_max_symbol_ - table_pos_);
+    std::fill_n(literals_.bit_length_.begin() + table_pos_, fill_length, value);
     return fill_length;
   };
 
-  // Read and build the Huffman literal table
-  if (decrunch_method_ != 1) {
-    pos        = 0;
-    fix        = 1;
-    max_symbol = 256;
-
-    do {
-      for (auto& bit_length : huffman20_.bit_length_) {
-        uint16_t val;
-        TRY(source->read_bits(4, val));
-        bit_length = static_cast<uint8_t>(val);
+  while (true) {
+    switch (table_field_) {
+    // Read the decrunch method
+    case TableField::Method: {
+      start();
+      uint32_t method = reader.read(3);
+      if (!commit()) return Status::Ok;
+
+      decrunch_method_ = method;
+      table_index_     = 0;
+      table_field_     = (method == 3) ? TableField::OffsetLength : TableField::DecrunchLength;
+      break;
+    }
+
+    // Read and build the offset Huffman table
+    case TableField::OffsetLength: {
+      start();
+      auto bit_length = static_cast<uint8_t>(reader.read(3));
+      if (!commit()) return Status::Ok;
+
+      offsets_.bit_length_[table_index_++] = bit_length;
+      if (table_index_ == offsets_.bit_length_.size()) {
+        TRY(offsets_cache_.reset_table(&offsets_));
+        table_field_ = TableField::DecrunchLength;
+      }
+      break;
+    }
+
+    // Read decrunch length
+    case TableField::DecrunchLength: {
+      start();
+      uint32_t hi_byte  = reader.read(8);
+      uint32_t mid_byte = reader.read(8);
+      uint32_t lo_byte  = reader.read(8);
+      if (!commit()) return Status::Ok;
+
+      decrunch_length_ = (hi_byte << 16) | (mid_byte << 8) | lo_byte;
+      if (decrunch_method_ == 1) {
+        table_field_ = TableField::Method;
+        complete     = true;
+        break;
+      }
+      table_index_      = 0;
+      table_pos_        = 0;
+      table_fix_        = 1;
+      table_max_symbol_ = 256;
+      table_field_      = TableField::PreTreeLength;
+      break;
+    }
+
+    // Read the Huffman table of the literal bit lengths, once for each of the two passes
+    case TableField::PreTreeLength: {
+      start();
+      auto bit_length = static_cast<uint8_t>(reader.read(4));
+      if (!commit()) return Status::Ok;
+
+      huffman20_.bit_length_[table_index_++] = bit_length;
+      if (table_index_ == huffman20_.bit_length_.size()) {
+        TRY(huffman20_.reset_table());
+        table_field_ = TableField::LiteralLength;
+      }
+      break;
+    }
+
+    // Read one run of literal bit lengths
+    case TableField::LiteralLength: {
+      start();
+      uint32_t symbol = huffman20_.decode(&reader);
+      uint32_t count  = 1;
+      uint8_t  value  = 0;
+
+      switch (symbol) {
+      case kSymbolZeroFill:
+        count = 3 + reader.read(4) + table_fix_;
+        break;
+
+      case kSymbolRepeatZero:
+        count = 19 + reader.read(6 - table_fix_) + table_fix_;
+        break;
+
+      case kSymbolRepeatPrevious:
+        count = 3 + reader.read(1) + table_fix_;
+        reader.refill();
+        symbol = huffman20_.decode(&reader);
+        if (reader.overrun()) return Status::Ok;
+        if (symbol >= kSymbolZeroFill) return Status::HuffmanTableError;
+        value = kBaseValues[literals_.bit_length_[table_pos_] + 17 - symbol];
+        break;
+
+      default:
+        value = kBaseValues[literals_.bit_length_[table_pos_] + 17 - symbol];
+        break;
       }
-      TRY(huffman20_.reset_table());
-
-      do {
-        uint16_t peeked;
-        TRY(source->peek_bits(6, peeked));
-        symbol = huffman20_.table_[peeked];
-
-        if (symbol >= kSymbolLongerThanSixBits) {
-          source->skip(0);  // This is not quite right if we need to consume bits.
-          // peek_bits/read_bits handle bit consumption.
-          // source->read_bits(6, peeked) consumes them.
-          TRY(source->read_bits(6, peeked));
-
-          do {
-            uint16_t bit;
-            TRY(source->read_bits(1, bit));
-            symbol = huffman20_.table_[symbol << 1 | bit];
-          } while (symbol >= kSymbolLongerThanSixBits);
-        } else {
-          uint16_t unused;
-          TRY(source->read_bits(huffman20_.bit_length_[symbol], unused));
-        }
-
-
-        switch (symbol) {
-        case kSymbolZeroFill: {
-          uint16_t bits;
-          TRY(source->read_bits(4, bits));
-          count = 3 + bits + fix;
-          pos += fill_literals_bit_lengths(count, 0);
-          break;
-        }
-
-        case kSymbolRepeatZero: {
-          uint16_t bits;
-          TRY(source->read_bits(6 - fix, bits));
-          count = 19 + bits + fix;
-          pos += fill_literals_bit_lengths(count, 0);
-          break;
-        }
-
-
-        case kSymbolRepeatPrevious: {
-          uint16_t bits;
-          TRY(source->read_bits(1, bits));
-          count = 3 + bits + fix;
-
-          TRY(source->peek_bits(6, bits));
-          symbol = huffman20_.table_[bits];
-
-          if (symbol >= kSymbolLongerThanSixBits) {
-            uint16_t unused;
-            TRY(source->read_bits(6, unused));
-            do {  // Symbol is longer than 6 bits
-              TRY(source->read_bits(1, bits));
-              symbol = huffman20_.table_[(symbol << 1) | bits];
-            } while (symbol >= kSymbolLongerThanSixBits);
-          } else {
-            uint16_t unused;
-            TRY(source->read_bits(huffman20_.bit_length_[symbol], unused));
-          }
-
-          symbol = kBaseValues[literals_.bit_length_[pos] + 17 - symbol];
-          pos += fill_literals_bit_lengths(count, static_cast<uint8_t>(symbol));
-          break;
-        }
-
-        default:
-          literals_.bit_length_[pos++] = kBaseValues[literals_.bit_length_[pos] + 17 - symbol];
-          break;
-        }
-      } while (pos < max_symbol);
-      fix--;
-      max_symbol += 512;
-    } while (max_symbol == 768);
-
-    TRY(literals_.reset_table());
+      if (!commit()) return Status::Ok;
+
+      table_pos_ += fill_literals_bit_lengths(count, value);
+      if (table_pos_ < table_max_symbol_) break;
+
+      table_fix_--;
+      table_max_symbol_ += 512;
+      if (table_max_symbol_ == 768) {
+        table_index_ = 0;
+        table_field_ = TableField::PreTreeLength;
+        break;
+      }
+
+      literal_pairs_built_      = false;
+      literal_pairs_profitable_ = false;
+      TRY(literals_cache_.reset_table(&literals_));
+      literal_pairs_profitable_ = literal_pairs_.is_profitable(literals_, 256);
+      table_field_              = TableField::Method;
+      complete                  = true;
+      break;
+    }
+    }
+
+    if (complete) break;
+  }
+
+  // Building the multi-symbol table costs about as much as decoding a few thousand symbols, so
+  // only do it for long blocks whose code favors literal pairs. Method 1 blocks keep the previous
+  // literal table, and with it the multi-symbol one.
+  use_literal_pairs_ = literal_pairs_profitable_ && decrunch_length_ >= kMultiSymbolMinLength;
+  if (use_literal_pairs_ && !literal_pairs_built_) {
+    literal_pairs_.build(literals_, 256);
+    literal_pairs_built_ = true;
   }
   return Status::Ok;
 }
@@ -163,36 +228,93 @@ Status HuffmanDecoder::read_literal_table(InputBuffer* source) {
 /* and source buffers. Most of the time is spent in this routine so it's  */
 /* pretty damn optimized. */
 
-// NOLINTBEGIN(readability-function-cognitive-complexity)
+// The unchecked loop runs while a maximal symbol, plus the overrun of a wide match copy, fits in both
+// the remaining input and the target span, so it drops the per-symbol bounds checks. The checked
+// loop then finishes the tail.
 Status HuffmanDecoder::decrunch(
-    InputBuffer* source, std::span<uint8_t> target, size_t& pos, size_t threshold) {
+    BitReader* source, std::span<uint8_t> target, size_t& pos, size_t threshold) {
+  TRY(decrunch_loop<false>(source, target, pos, threshold));
+  return decrunch_loop<true>(source, target, pos, threshold);
+}
+
+// Near the end of the data, symbols are decoded one at a time on a copy of the stream, so that the
+// first one running past the end can be dropped along with its effect on the match state.
+Status HuffmanDecoder::decrunch_available(
+    BitReader* source, std::span<uint8_t> target, size_t& pos, size_t threshold) {
+  TRY(decrunch_loop<false>(source, target, pos, threshold));
+
+  while (pos < threshold) {
+    BitReader reader      = *source;
+    size_t    next        = pos;
+    uint32_t  last_offset = last_offset_;
+    Status    status      = decrunch_loop<true>(&reader, target, next, pos + 1);
+    if (reader.overrun()) {
+      last_offset_ = last_offset;
+      return Status::Ok;
+    }
+    TRY(status);
+
+    *source = reader;
+    pos     = next;
+  }
+  return Status::Ok;
+}
+
+// NOLINTBEGIN(readability-function-cognitive-complexity)
+template <bool kChecked>
+Status HuffmanDecoder::decrunch_loop(
+    BitReader* source, std::span<uint8_t> target, size_t& target_pos, size_t threshold) {
   uint32_t temp;
   uint32_t symbol;
   uint32_t count;
 
-  while (pos < threshold && (!source->is_eof())) {
-    uint16_t symbol_data;
-    TRY(source->peek_bits(12, symbol_data));
-    symbol = literals_.table_[symbol_data];
+  // Work on local copies: every byte stored to `target` may alias the decoder state, which would
+  // otherwise force it to be reloaded from memory after each store.
+  BitReader reader      = *source;
+  size_t    pos         = target_pos;
+  uint32_t  last_offset = last_offset_;
+  Status    status      = Status::Ok;
 
-    if (symbol >= 768) {
-      uint16_t unused;
-      TRY(source->read_bits(12, unused));
+  auto has_margin = [&]() {
+    if constexpr (kChecked) {
+      return !reader.overrun();
+    } else {
+      return reader.can_refill_unchecked() &&
+             target.size() - pos >= kMaxMatchLength + kMatchCopyOverrun;
+    }
+  };
 
-      do { /* literal is longer than 12 bits */
-        uint16_t bit;
-        TRY(source->read_bits(1, bit));
-        symbol = literals_.table_[(symbol << 1) | bit];
-      } while (symbol >= 768);
+  while (pos < threshold && has_margin()) {
+    // A single refill covers the longest symbol: a 16-bit literal code, 18 bits of offset and
+    // 6 bits of match length.
+    if constexpr (kChecked) {
+      reader.refill();
     } else {
-      temp = literals_.bit_length_[symbol];
-      uint16_t unused;
-      TRY(source->read_bits(temp, unused));
+      reader.refill_unchecked();
     }
 
+    // Up to two literals at once; the count is capped so that the block end is never crossed.
+    // The second literal is stored even when only one was decoded: `threshold` keeps it inside
+    // the bytes still to decode, and the next symbol overwrites it.
+    if (!kChecked && use_literal_pairs_ && threshold - pos >= MultiSymbolTable::kMaxSymbols) {
+      const auto& pair = literal_pairs_.lookup(reader);
+      if (pair.count != 0) {
+        target[pos]     = pair.literals[0];
+        target[pos + 1] = pair.literals[1];
+        pos += pair.count;
+        reader.consume(pair.length);
+        continue;
+      }
+    }
+
+    symbol = literals_.decode(&reader);
+
     // Direct byte to put in the decode buffer.
     if (symbol < 256) {
-      if (pos >= target.size()) return Status::BufferOverflow;
+      if (kChecked && pos >= target.size()) {
+        status = Status::BufferOverflow;
+        break;
+      }
       target[pos++] = static_cast<uint8_t>(symbol);
       continue;
     }
@@ -203,39 +325,49 @@ Status HuffmanDecoder::decrunch(
     temp  = kSymbolBitLengths[temp];
     if ((temp >= 3) && (decrunch_method_ == 3)) {
       temp -= 3;
-      uint16_t bits;
-      TRY(source->read_bits(temp, bits));
-      count += bits << 3;
+      count += reader.peek(temp) << 3;
+      reader.consume(temp);
 
-      TRY(source->peek_bits(7, bits));
-      count += (temp = offsets_.table_[bits]);
-      temp = offsets_.bit_length_[temp];
+      count += offsets_.decode(&reader);
     } else {
-      uint16_t bits;
-      TRY(source->peek_bits(temp, bits));
-      count += bits;
-      if (count == 0U) count = last_offset_;
+      count += reader.peek(temp);
+      reader.consume(temp);
+      if (count == 0U) count = last_offset;
     }
 
-    uint16_t unused;
-    TRY(source->read_bits(temp, unused));
-    last_offset_ = count;
+    last_offset = count;
 
     count = kBaseOffsets[temp = (symbol >> 5) & 15] + 3;
     temp  = kSymbolBitLengths[temp];
-    uint16_t bits;
-    TRY(source->read_bits(temp, bits));
-    count += bits;
+    count += reader.peek(temp);
+    reader.consume(temp);
 
-    if (last_offset_ > pos) return Status::OutOfRange;
-    if (pos + count > target.size()) return Status::BufferOverflow;
+    if (last_offset > pos) {
+      status = Status::OutOfRange;
+      break;
+    }
+    if (kChecked && pos + count > target.size()) {
+      status = Status::BufferOverflow;
+      break;
+    }
 
-    size_t start_idx = pos - last_offset_;
-    for (size_t i = 0; i < count; ++i) {
-      target[pos++] = target[start_idx + i];
+    if constexpr (kChecked) {
+      size_t start_idx = pos - last_offset;
+      for (size_t i = 0; i < count; ++i) {
+        target[pos++] = target[start_idx + i];
+      }
+    } else {
+      copy_match(target.data() + pos, last_offset, count);
+      pos += count;
     }
   }
-  return Status::Ok;
+
+  *source      = reader;
+  target_pos   = pos;
+  last_offset_ = last_offset;
+
+  if (kChecked && status == Status::Ok && reader.overrun()) return Status::UnexpectedEof;
+  return status;
 }
 // NOLINTEND(readability-function-cognitive-complexity)
 
@@ -4,35 +4,98 @@
 #include <span>
 #include <vector>
 
+#include "bit_reader.hh"
 #include "error.hh"
 #include "huffman_table.hh"
-#include "mmap_buffer.hh"
 
 namespace huffman {
 
 class HuffmanDecoder {
  public:
+  /// Longest match a single symbol can produce.
+  static constexpr size_t kMaxMatchLength = 258;
+
+  /// Smallest decrunch length for which building the multi-symbol literal table pays off.
+  /// huffman_table_bench puts the crossover at about 8K literals, but there the table only
+  /// breaks even, and from run to run it is slower about as often as faster; it wins clearly from
+  /// 16K. The length also counts bytes produced by matches, so a sub-block of 16K bytes holds
+  /// fewer literals than that.
+  static constexpr uint32_t kMultiSymbolMinLength = 16384;
+
+  /**
+   * @brief What the decoder carries from one symbol to the next, for `restore_state()`.
+   *
+   * Decode tables are not saved: they are rebuilt from the bit lengths.
+   */
+  struct State {
+    std::vector<uint8_t> literal_lengths;   ///< Bit lengths of the literal code.
+    std::vector<uint8_t> offset_lengths;    ///< Bit lengths of the offset code.
+    uint32_t             decrunch_method{};  ///< Method of the current sub-block.
+    uint32_t             decrunch_length{};  ///< Length of the current sub-block.
+    uint32_t             last_offset{1};     ///< Offset of the last match.
+  };
+
   /**
    * @brief Constructs a new HuffmanDecoder.
    */
   HuffmanDecoder();
 
   /**
-   * @brief Reads the literal table from the input buffer.
-   * @param data The input buffer containing the literal table data.
+   * @brief Saves the state between two symbols.
+   * @return The state.
+   */
+  State save_state() const;
+
+  /**
+   * @brief Restores a state saved with `save_state()`, rebuilding the decode tables.
+   * @param state The state.
    * @return Status indicating success or the specific error encountered.
    */
-  Status read_literal_table(InputBuffer* data);
+  Status restore_state(const State& state);
 
   /**
-   * @brief Decrunches data from the input buffer into the target span.
-   * @param data The input buffer containing compressed data.
+   * @brief Reads the literal table from the bit stream.
+   * @param data The bit stream containing the literal table data.
+   * @return Status indicating success or the specific error encountered.
+   */
+  Status read_literal_table(BitReader* data);
+
+  /**
+   * @brief Reads as much of the literal table as the bit stream holds.
+   *
+   * Stops before the first field that runs past the end of the data, leaving the stream there.
+   * The next call resumes at that field, given a stream that continues this one.
+   *
+   * @param data The bit stream containing the literal table data.
+   * @param complete Set once the whole table has been read.
+   * @return Status indicating success or the specific error encountered.
+   */
+  Status read_literal_table(BitReader* data, bool& complete);
+
+  /**
+   * @brief Decrunches data from the bit stream into the target span.
+   *
+   * Runs without per-symbol bounds checks while at least `kMaxMatchLength + kMatchCopyOverrun`
+   * bytes of the target span and a full refill of input remain, then finishes with a fully
+   * checked loop. Bytes of the target span past `threshold` may be overwritten.
+   * @param data The bit stream containing compressed data.
+   * @param target The target span to write decompressed data into.
+   * @param pos The current position in the target span, updated upon successful decrunching.
+   * @param threshold The threshold size for decrunching.
+   * @return Status indicating success or the specific error encountered.
+   */
+  Status decrunch(BitReader* data, std::span<uint8_t> target, size_t& pos, size_t threshold);
+
+  /**
+   * @brief Same as `decrunch()`, but stops before the first symbol that runs past the end of the
+   *        data instead of failing, leaving the stream there.
+   * @param data The bit stream containing compressed data.
    * @param target The target span to write decompressed data into.
    * @param pos The current position in the target span, updated upon successful decrunching.
    * @param threshold The threshold size for decrunching.
    * @return Status indicating success or the specific error encountered.
    */
-  Status decrunch(InputBuffer* data, std::span<uint8_t> target, size_t& pos, size_t threshold);
+  Status decrunch_available(BitReader* data, std::span<uint8_t> target, size_t& pos, size_t threshold);
 
   /**
    * @brief Gets the decrunched length.
@@ -42,10 +105,41 @@ class HuffmanDecoder {
     return decrunch_length_;
   }
 
+  /**
+   * @brief Gets the decode table cache counters, summed over the literal and offset tables.
+   * @return The number of tables reused and built so far.
+   */
+  HuffmanTableCache::Stats table_cache_stats() const {
+    HuffmanTableCache::Stats stats = literals_cache_.stats();
+    stats += offsets_cache_.stats();
+    return stats;
+  }
+
  private:
+  template <bool kChecked>
+  Status decrunch_loop(
+      BitReader* data, std::span<uint8_t> target, size_t& target_pos, size_t threshold);
+
   HuffmanTable offsets_;
   HuffmanTable huffman20_;
   HuffmanTable literals_;
+  MultiSymbolTable literal_pairs_;
+  HuffmanTableCache offsets_cache_;
+  HuffmanTableCache literals_cache_;
+  // Whether `literal_pairs_` is worth building for `literals_`, has been built for it, and is used
+  // for the current block.
+  bool literal_pairs_profitable_{};
+  bool literal_pairs_built_{};
+  bool use_literal_pairs_{};
+
+  // Where `read_literal_table()` stopped: the next field to read and, for the literal bit lengths,
+  // the state of the run-length decoder.
+  enum class TableField : uint8_t { Method, OffsetLength, DecrunchLength, PreTreeLength, LiteralLength };
+  TableField table_field_ = TableField::Method;
+  uint32_t   table_index_{};
+  uint32_t   table_pos_{};
+  uint32_t   table_fix_{};
+  uint32_t   table_max_symbol_{};
 
   uint32_t decrunch_method_{};
   uint32_t decrunch_length_{};
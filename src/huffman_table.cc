@@ -1,120 +1,258 @@
 #include "huffman_table.hh"
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
-#include <stdexcept>
+#include <cstring>
 
 namespace huffman {
 
-HuffmanTable::HuffmanTable(size_t table_bits, size_t num_symbols, size_t num_decode_entries)
-    : table_bits_{table_bits} {
+namespace {
+
+/// Bit-reversed values of all bytes, e.g. 0b00000110 maps to 0b01100000.
+constexpr std::array<uint8_t, 256> kReversedBytes = []() {
+  std::array<uint8_t, 256> table{};
+  for (uint32_t value = 0; value < table.size(); value++) {
+    for (uint32_t bit = 0; bit < 8; bit++) {
+      table[value] |= static_cast<uint8_t>(((value >> bit) & 1) << (7 - bit));
+    }
+  }
+  return table;
+}();
+
+/// Reverses the lowest `bits` bits of `value`, e.g. 0bABC becomes 0bCBA for 3 bits.
+constexpr uint32_t reverse_bits(uint32_t value, size_t bits) {
+  uint32_t reversed = (kReversedBytes[value & 0xFF] << 8) | kReversedBytes[(value >> 8) & 0xFF];
+  return reversed >> (16 - bits);
+}
+static_assert(reverse_bits(0b110, 3) == 0b011);
+static_assert(reverse_bits(0b1000000000000001, 16) == 0b1000000000000001);
+static_assert(reverse_bits(0b0000000000000011, 16) == 0b1100000000000000);
+
+/// Hashes a bit-length vector eight lengths at a time.
+uint64_t hash_bit_lengths(const std::vector<uint8_t>& bit_lengths) {
+  constexpr uint64_t kMultiplier = 0x9E3779B97F4A7C15ULL;
+
+  uint64_t hash = bit_lengths.size();
+  size_t   pos  = 0;
+  for (; pos + sizeof(uint64_t) <= bit_lengths.size(); pos += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bit_lengths.data() + pos, sizeof(word));
+    hash = (hash ^ word) * kMultiplier;
+    hash ^= hash >> 29;
+  }
+  for (; pos < bit_lengths.size(); pos++) {
+    hash = (hash ^ bit_lengths[pos]) * kMultiplier;
+  }
+  return hash ^ (hash >> 32);
+}
+
+}  // namespace
+
+HuffmanTable::HuffmanTable(size_t table_bits, size_t num_symbols) : table_bits_{table_bits} {
   bit_length_.resize(num_symbols);
-  table_.resize(num_decode_entries);
+  table_.resize(size_t{1} << table_bits_);
 }
 
 /**
- * @brief Build a fast Huffman decode table from the symbol bit lengths.
+ * @brief Build a two-level Huffman decode table from the symbol bit lengths.
  *
- * This function constructs a decode table for Huffman coding based on the provided bit lengths
- * for each symbol. It handles symbols with bit lengths both less than or equal to, and greater
- * than the specified table size.
+ * Codes are assigned canonically: shorter codes first, ties broken by symbol order. Symbols are
+ * put in that order with a counting sort on their bit lengths. Codes of up to `table_bits_` bits
+ * are replicated across the root table; longer codes share a root slot per `table_bits_` prefix,
+ * pointing at a sub-table sized for the longest code under that prefix.
  *
- * @param table_bits The number of bits in the decode table.
- * @return bool Returns true on success, false if an error occurred (e.g., table creation was
- * aborted).
+ * @return Status::HuffmanTableError if the bit lengths do not describe a complete prefix code.
  */
 // NOLINTBEGIN(readability-function-cognitive-complexity)
 Status HuffmanTable::reset_table() {
-  uint8_t  current_bit_length = 0;
-  uint32_t symbol;
-  uint32_t leaf;
-  uint32_t table_mask = 1 << table_bits_;
-  uint32_t bit_mask   = table_mask >> 1;
-  uint32_t position   = 0;
-  uint32_t fill;
-  uint32_t next_symbol;
-
-  current_bit_length++;
-
-  // Reverse the position bits, keeping at most `table_bits_`.
-  // e.g. if `value` is 0bABCD and `table_bits_` is 3, then result will be 0bDCB.
-  auto reverse_bits = [this](uint32_t value) {
-    uint32_t leaf = 0;
-    for (size_t i = 0; i < table_bits_; i++) {
-      leaf = (leaf << 1) | ((value >> i) & 1);
+  const uint32_t root_size = 1U << table_bits_;
+
+  // Number of codes of each length. Lengths past `kMaxCodeLength` are not part of the code.
+  uint32_t count[kMaxCodeLength + 1] = {};
+  for (auto length : bit_length_) {
+    if (length <= kMaxCodeLength) count[length]++;
+  }
+
+  // The code must be complete: neither over-subscribed nor leaving unused code space.
+  int32_t left = 1;
+  for (size_t length = 1; length <= kMaxCodeLength; length++) {
+    left = (left << 1) - static_cast<int32_t>(count[length]);
+    if (left < 0) return Status::HuffmanTableError;
+  }
+  if (left != 0) return Status::HuffmanTableError;
+
+  // Counting sort of the symbols by bit length, stable in symbol order.
+  uint32_t offset[kMaxCodeLength + 2] = {};
+  for (size_t length = 1; length <= kMaxCodeLength; length++) {
+    offset[length + 1] = offset[length] + count[length];
+  }
+  sorted_symbols_.resize(offset[kMaxCodeLength + 1]);
+  for (uint32_t symbol = 0; symbol < bit_length_.size(); symbol++) {
+    uint8_t length = bit_length_[symbol];
+    if (length != 0 && length <= kMaxCodeLength) {
+      sorted_symbols_[offset[length]++] = static_cast<uint16_t>(symbol);
     }
-    return leaf;
-  };
+  }
+
+  // The complete code covers every root slot, so the root needs no clearing.
+  table_.resize(root_size);
 
-  // First pass: fill the table for symbols with bit lengths <= table_bits_
-  while (current_bit_length <= table_bits_) {
-    for (symbol = 0; symbol < bit_length_.size(); symbol++) {
-      if (bit_length_[symbol] != current_bit_length) {
-        continue;
+  uint32_t code   = 0;  // Next canonical code, left-aligned to `kMaxCodeLength` bits.
+  size_t   next   = 0;  // Index into `sorted_symbols_`.
+  uint32_t length = 1;
+
+  // Codes that fit the root table, replicated across the unused high index bits.
+  for (; length <= table_bits_; length++) {
+    for (uint32_t n = 0; n < count[length]; n++) {
+      Entry    entry = {sorted_symbols_[next++], static_cast<uint8_t>(length), 0};
+      uint32_t leaf  = reverse_bits(code >> (kMaxCodeLength - length), length);
+      for (; leaf < root_size; leaf += 1U << length) {
+        table_[leaf] = entry;
       }
+      code += 1U << (kMaxCodeLength - length);
+    }
+  }
+
+  // Codes longer than the root table go to sub-tables.
+  uint32_t current_prefix = root_size;
+  uint32_t subtable_start = 0;
+  uint32_t subtable_bits  = 0;
 
-      leaf = reverse_bits(position);
+  for (; length <= kMaxCodeLength; length++) {
+    for (; count[length] > 0; count[length]--) {
+      uint32_t prefix = code >> (kMaxCodeLength - table_bits_);
+
+      if (prefix != current_prefix) {
+        // Grow the sub-table until the codes left to place fill it; canonical order guarantees
+        // they are the ones sharing this prefix.
+        subtable_bits = length - static_cast<uint32_t>(table_bits_);
+        int32_t space = 1 << subtable_bits;
+        while (table_bits_ + subtable_bits < kMaxCodeLength) {
+          space -= static_cast<int32_t>(count[table_bits_ + subtable_bits]);
+          if (space <= 0) break;
+          subtable_bits++;
+          space <<= 1;
+        }
 
-      position += bit_mask;
-      if (position > table_mask) {
-        return Status::HuffmanTableError;
+        current_prefix = prefix;
+        subtable_start = static_cast<uint32_t>(table_.size());
+        table_.resize(table_.size() + (size_t{1} << subtable_bits));
+        table_[reverse_bits(prefix, table_bits_)] = {static_cast<uint16_t>(subtable_start),
+            static_cast<uint8_t>(table_bits_), static_cast<uint8_t>(subtable_bits)};
       }
 
-      fill        = bit_mask;
-      next_symbol = 1 << current_bit_length;
-      while (fill > 0) {
-        fill--;
-        table_[leaf] = static_cast<uint16_t>(symbol);
-        leaf += next_symbol;
+      uint32_t sub_length = length - static_cast<uint32_t>(table_bits_);
+      Entry    entry      = {sorted_symbols_[next++], static_cast<uint8_t>(sub_length), 0};
+      uint32_t leaf       = reverse_bits(code >> (kMaxCodeLength - length), sub_length);
+      for (; leaf < (1U << subtable_bits); leaf += 1U << sub_length) {
+        table_[subtable_start + leaf] = entry;
       }
+      code += 1U << (kMaxCodeLength - length);
     }
-    bit_mask >>= 1;
-    current_bit_length++;
   }
 
-  // Second pass: fill the table for symbols with bit lengths > table_bits_
-  if (position != table_mask) {
-    for (symbol = position; symbol < table_mask; symbol++) {
-      leaf         = reverse_bits(symbol);
-      table_[leaf] = 0;
+  return Status::Ok;
+}
+// NOLINTEND(readability-function-cognitive-complexity)
+
+HuffmanTableCache::HuffmanTableCache(size_t capacity) {
+  slots_.resize(capacity > 0 ? capacity : 1);
+}
+
+Status HuffmanTableCache::reset_table(HuffmanTable* table) {
+  const uint64_t hash = hash_bit_lengths(table->bit_length_);
+  clock_++;
+
+  // Put the live decode table back into its slot first.
+  if (live_ != kNoSlot) {
+    slots_[live_].table.swap(table->table_);
+    live_ = kNoSlot;
+  }
+
+  for (size_t index = 0; index < slots_.size(); index++) {
+    Slot& slot = slots_[index];
+    if (slot.hash == hash && !slot.table.empty() && slot.bit_length == table->bit_length_) {
+      stats_.hits++;
+      slot.table.swap(table->table_);
+      slot.last_used = clock_;
+      live_          = index;
+      return Status::Ok;
     }
+  }
 
-    next_symbol = table_mask >> 1;
-    position <<= 16;
-    table_mask <<= 16;
-    bit_mask = 32768;
-
-    while (current_bit_length <= 16) {
-      for (symbol = 0; symbol < bit_length_.size(); symbol++) {
-        if (bit_length_[symbol] == current_bit_length) {
-          leaf = reverse_bits(position >> 16);
-
-          for (fill = 0; fill < current_bit_length - table_bits_; fill++) {
-            if (table_[leaf] == 0) {
-              table_[next_symbol << 1]       = 0;
-              table_[(next_symbol << 1) + 1] = 0;
-              table_[leaf]                   = static_cast<uint16_t>(next_symbol++);
-            }
-            leaf = (table_[leaf] << 1) | ((position >> (15 - fill)) & 1);
-          }
-
-          table_[leaf] = static_cast<uint16_t>(symbol);
-          position += bit_mask;
-          if (position > table_mask) {
-            return Status::HuffmanTableError;
-          }
-        }
+  stats_.misses++;
+  // Evict the least recently used slot, and build into its storage.
+  Slot& victim = *std::min_element(slots_.begin(), slots_.end(),
+      [](const Slot& a, const Slot& b) { return a.last_used < b.last_used; });
+  victim.table.swap(table->table_);
+  victim.table.clear();
+  victim.last_used = 0;
+
+  TRY(table->reset_table());
+
+  victim.hash       = hash;
+  victim.bit_length = table->bit_length_;
+  victim.last_used  = clock_;
+  live_             = static_cast<size_t>(&victim - slots_.data());
+  return Status::Ok;
+}
+
+MultiSymbolTable::MultiSymbolTable(size_t table_bits) : table_bits_{table_bits} {
+  table_.resize(size_t{1} << table_bits_);
+}
+
+void MultiSymbolTable::build(const HuffmanTable& source, uint32_t num_literals) {
+  const uint32_t root_mask = (1U << source.table_bits_) - 1;
+
+  // A root slot resolves a literal if it is not a sub-table pointer and its code fits `bits`.
+  auto literal_at = [&](uint32_t index, size_t bits) -> const HuffmanTable::Entry* {
+    const auto& entry = source.table_[index & root_mask];
+    if (entry.subtable_bits != 0 || entry.symbol >= num_literals || entry.length > bits) {
+      return nullptr;
+    }
+    return &entry;
+  };
+
+  for (uint32_t index = 0; index < table_.size(); index++) {
+    Entry slot{};
+
+    if (const auto* first = literal_at(index, table_bits_)) {
+      slot = {{static_cast<uint8_t>(first->symbol), 0}, 1, first->length};
+
+      if (const auto* second = literal_at(index >> first->length, table_bits_ - first->length)) {
+        slot.literals[1] = static_cast<uint8_t>(second->symbol);
+        slot.count       = 2;
+        slot.length      = static_cast<uint8_t>(slot.length + second->length);
       }
-      bit_mask >>= 1;
-      current_bit_length++;
+    }
+
+    table_[index] = slot;
+  }
+}
+
+bool MultiSymbolTable::is_profitable(const HuffmanTable& source, uint32_t num_literals) const {
+  // Probability mass, in units of 2^-table_bits_, of the literal codes of each length.
+  uint64_t literal_mass[HuffmanTable::kMaxCodeLength + 1] = {};
+  for (uint32_t symbol = 0; symbol < num_literals && symbol < source.bit_length_.size(); symbol++) {
+    uint8_t length = source.bit_length_[symbol];
+    if (length != 0 && length <= table_bits_ && length <= source.table_bits_) {
+      literal_mass[length] += uint64_t{1} << (table_bits_ - length);
     }
   }
 
-  if (position != table_mask) {
-    return Status::HuffmanTableError;
+  const uint64_t total = uint64_t{1} << table_bits_;
+  uint64_t       fits  = 0;  // Mass of single literals that fit the table.
+  uint64_t       pairs = 0;  // Mass of literal pairs that fit the table, in units of 2^-2*table_bits_.
+  for (size_t first = 1; first <= table_bits_; first++) {
+    fits += literal_mass[first];
+    for (size_t second = 1; first + second <= table_bits_; second++) {
+      pairs += literal_mass[first] * literal_mass[second];
+    }
   }
 
-  return Status::Ok;
+  uint64_t misses = total - fits;
+  return pairs > misses * total;
 }
-// NOLINTEND(readability-function-cognitive-complexity)
 
 }  // namespace huffman
\ No newline at end of file
@@ -4,30 +4,197 @@
 #include <cstdint>
 #include <vector>
 
+#include "bit_reader.hh"
 #include "error.hh"
 
 namespace huffman {
 class HuffmanTable {
  public:
+  /// Longest code length the table can decode.
+  static constexpr size_t kMaxCodeLength = 16;
+
+  /**
+   * @brief A decode table slot.
+   *
+   * Root slots for codes longer than `table_bits_` hold the offset of a sub-table indexed by the
+   * next `subtable_bits` bits of the stream; all other slots hold a decoded symbol.
+   */
+  struct Entry {
+    uint16_t symbol;         ///< Decoded symbol, or sub-table offset.
+    uint8_t  length;         ///< Number of bits to consume for this slot.
+    uint8_t  subtable_bits;  ///< Sub-table index width, 0 for symbol slots.
+  };
+  static_assert(sizeof(Entry) == 4);
+
   /**
    * @brief Constructs a new HuffmanTable.
    * @param table_bits Number of bits per entry in the table.
    * @param num_symbols Number of symbols.
-   * @param num_decode_entries Number of decode entries.
    */
-  HuffmanTable(size_t table_bits, size_t num_symbols, size_t num_decode_entries);
+  HuffmanTable(size_t table_bits, size_t num_symbols);
   // Num bits per entry.
   const size_t table_bits_;
   // Array of bit lengths for each symbol.
   std::vector<uint8_t> bit_length_;
-  // The decode table.
-  std::vector<uint16_t> table_;
+  // The decode table: `1 << table_bits_` root slots followed by the sub-tables.
+  std::vector<Entry> table_;
 
   /**
    * @brief Resets the Huffman table.
    * @return Status indicating success or the specific error encountered.
    */
   Status reset_table();
+
+  /**
+   * @brief Decodes and consumes a single symbol.
+   *
+   * The reader must hold at least `kMaxCodeLength` buffered bits.
+   *
+   * @param reader The bit stream to decode from.
+   * @return The decoded symbol.
+   */
+  uint32_t decode(BitReader* reader) const {
+    Entry entry = table_[reader->peek(table_bits_)];
+    if (entry.subtable_bits != 0) {
+      reader->consume(table_bits_);
+      entry = table_[entry.symbol + reader->peek(entry.subtable_bits)];
+    }
+    reader->consume(entry.length);
+    return entry.symbol;
+  }
+
+ private:
+  // Scratch space for sorting symbols by bit length.
+  std::vector<uint16_t> sorted_symbols_;
+};
+
+/**
+ * @brief Small cache of built decode tables for a single HuffmanTable, keyed by its bit lengths.
+ *
+ * Blocks produced with the same packer settings often repeat the previous code, or one seen a few
+ * blocks earlier. The cache keeps the last few decode tables and swaps them in and out of the
+ * HuffmanTable, so a hit costs a hash and a compare of the bit lengths instead of a rebuild.
+ */
+class HuffmanTableCache {
+ public:
+  /// Number of cached codes.
+  static constexpr size_t kDefaultCapacity = 4;
+
+  /**
+   * @brief Lookup counters.
+   */
+  struct Stats {
+    uint64_t hits{};    ///< Tables taken from the cache.
+    uint64_t misses{};  ///< Tables built with `HuffmanTable::reset_table()`.
+
+    Stats& operator+=(const Stats& other) {
+      hits += other.hits;
+      misses += other.misses;
+      return *this;
+    }
+  };
+
+  /**
+   * @brief Constructs a new HuffmanTableCache.
+   * @param capacity Number of decode tables to keep, at least 1.
+   */
+  explicit HuffmanTableCache(size_t capacity = kDefaultCapacity);
+
+  /**
+   * @brief Same as `table->reset_table()`, reusing a cached decode table when possible.
+   *
+   * The cache owns the decode tables it hands out: `table` must always be reset through the same
+   * cache, and its `table_` must not be modified otherwise.
+   *
+   * @param table The table to rebuild from its `bit_length_`.
+   * @return Status indicating success or the specific error encountered.
+   */
+  Status reset_table(HuffmanTable* table);
+
+  /**
+   * @brief Gets the lookup counters.
+   * @return The number of hits and misses so far.
+   */
+  const Stats& stats() const {
+    return stats_;
+  }
+
+ private:
+  struct Slot {
+    uint64_t                         hash{};
+    uint64_t                         last_used{};
+    std::vector<uint8_t>             bit_length;
+    // Empty while the slot is live: its decode table is then held by the HuffmanTable.
+    std::vector<HuffmanTable::Entry> table;
+  };
+
+  static constexpr size_t kNoSlot = ~size_t{0};
+
+  std::vector<Slot> slots_;
+  // Slot whose code the HuffmanTable currently holds.
+  size_t   live_{kNoSlot};
+  uint64_t clock_{};
+  Stats    stats_;
+};
+
+/**
+ * @brief Decode table resolving up to two consecutive short literal codes in a single lookup.
+ *
+ * Built from the root of a HuffmanTable. Slots whose leading code is not a literal, or does not
+ * fit the root, have a zero `count` and must be decoded through the HuffmanTable instead.
+ */
+class MultiSymbolTable {
+ public:
+  /// Most symbols a single slot can emit.
+  static constexpr size_t kMaxSymbols = 2;
+
+  /**
+   * @brief A decode table slot.
+   */
+  struct Entry {
+    uint8_t literals[kMaxSymbols];  ///< Decoded literals, `count` of them valid.
+    uint8_t count;                  ///< Number of literals decoded, 0 if none fit.
+    uint8_t length;                 ///< Number of bits to consume for all `count` literals.
+  };
+  static_assert(sizeof(Entry) == 4);
+
+  /**
+   * @brief Constructs a new MultiSymbolTable.
+   * @param table_bits Number of bits per entry in the table.
+   */
+  explicit MultiSymbolTable(size_t table_bits);
+  // Num bits per entry.
+  const size_t table_bits_;
+  // The decode table.
+  std::vector<Entry> table_;
+
+  /**
+   * @brief Rebuilds the table from the given Huffman table.
+   * @param source A successfully built table with at least `table_bits_` root bits.
+   * @param num_literals Symbols below this value are literals.
+   */
+  void build(const HuffmanTable& source, uint32_t num_literals);
+
+  /**
+   * @brief Checks whether a table built from the given code would likely speed decoding up.
+   *
+   * Under the code's own symbol distribution, compares the chance that a lookup decodes two
+   * literals against the chance that it misses and falls back to the HuffmanTable.
+   *
+   * @param source A successfully built table.
+   * @param num_literals Symbols below this value are literals.
+   * @return True if pairs are more likely than misses.
+   */
+  bool is_profitable(const HuffmanTable& source, uint32_t num_literals) const;
+
+  /**
+   * @brief Looks up the slot for the next `table_bits_` bits of the stream without consuming them.
+   * @param reader The bit stream to decode from.
+   * @return The matching table slot.
+   */
+  const Entry& lookup(const BitReader& reader) const {
+    return table_[reader.peek(table_bits_)];
+  }
 };
 
-}  // namespace huffman
\ No newline at end of file
+}  // namespace huffman
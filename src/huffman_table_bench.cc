@@ -0,0 +1,292 @@
+// Microbenchmarks for the Huffman decode tables.
+//
+// reset-table: HuffmanTable::reset_table() against the previous builder, which rescanned every
+// symbol once per code length and reversed bits one at a time.
+//
+// multi-symbol: decoding a literal-only stream one code per lookup, versus building a
+// MultiSymbolTable first and decoding up to two literals per lookup. The build cost is paid once
+// per block, so the table only pays off past a certain block length: the crossover point.
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "bit_reader.hh"
+#include "huffman_table.hh"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t kNumLiterals  = 256;
+constexpr size_t kLiteralsBits = 12;
+constexpr size_t kMaxLength    = 11;
+
+/// Literal code lengths resembling text: a few very short codes, a long tail.
+std::vector<uint8_t> make_literal_lengths() {
+  std::vector<uint8_t> lengths(kNumLiterals);
+  for (size_t symbol = 0; symbol < kNumLiterals; ++symbol) {
+    if (symbol < 4) {
+      lengths[symbol] = 3;
+    } else if (symbol < 12) {
+      lengths[symbol] = 5;
+    } else if (symbol < 28) {
+      lengths[symbol] = 7;
+    } else if (symbol < 56) {
+      lengths[symbol] = 10;
+    } else {
+      lengths[symbol] = 11;
+    }
+  }
+  return lengths;
+}
+
+/// Encodes `count` random literals, each drawn with probability 2^-length, as an LZX bit stream.
+std::vector<uint8_t> make_stream(const std::vector<uint8_t>& lengths, size_t count) {
+  // Canonical codes, matching HuffmanTable::reset_table().
+  std::vector<uint32_t> codes(lengths.size());
+  std::vector<uint32_t> pool;
+  uint32_t              code = 0;
+  for (uint32_t length = 1; length <= huffman::HuffmanTable::kMaxCodeLength; ++length) {
+    for (size_t symbol = 0; symbol < lengths.size(); ++symbol) {
+      if (lengths[symbol] != length) continue;
+      codes[symbol] = code >> (huffman::HuffmanTable::kMaxCodeLength - length);
+      code += 1U << (huffman::HuffmanTable::kMaxCodeLength - length);
+      pool.insert(pool.end(), size_t{1} << (kMaxLength - length), static_cast<uint32_t>(symbol));
+    }
+  }
+
+  std::mt19937         rng(1);
+  std::vector<uint8_t> stream;
+  uint32_t             word = 0;
+  size_t               bits = 0;
+  auto                 put  = [&](uint32_t bit) {
+    word |= bit << bits;
+    if (++bits == 16) {
+      stream.push_back(static_cast<uint8_t>(word >> 8));
+      stream.push_back(static_cast<uint8_t>(word));
+      word = 0;
+      bits = 0;
+    }
+  };
+
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t symbol = pool[rng() % pool.size()];
+    for (uint32_t bit = lengths[symbol]; bit-- > 0;) {
+      put((codes[symbol] >> bit) & 1);
+    }
+  }
+  // Padding, so that every refill in the loops below is a bulk one.
+  for (size_t i = 0; i < 128; ++i) put(0);
+  return stream;
+}
+
+/// The previous HuffmanTable::reset_table(), kept as a baseline.
+// NOLINTBEGIN(readability-function-cognitive-complexity)
+Status reset_table_scanning(huffman::HuffmanTable& table) {
+  constexpr uint32_t kMaxCodeLength = huffman::HuffmanTable::kMaxCodeLength;
+  const size_t       table_bits     = table.table_bits_;
+  const uint32_t     root_size      = 1U << table_bits;
+  const uint32_t     code_limit     = 1U << kMaxCodeLength;
+
+  auto reverse_bits = [](uint32_t value, size_t bits) {
+    uint32_t result = 0;
+    for (size_t i = 0; i < bits; i++) {
+      result = (result << 1) | ((value >> i) & 1);
+    }
+    return result;
+  };
+
+  uint32_t remaining[kMaxCodeLength + 1] = {};
+  for (auto length : table.bit_length_) {
+    if (length <= kMaxCodeLength) remaining[length]++;
+  }
+
+  table.table_.clear();
+  table.table_.resize(root_size);
+
+  uint32_t code = 0;
+  for (uint32_t length = 1; length <= table_bits; length++) {
+    for (uint32_t symbol = 0; remaining[length] > 0; symbol++) {
+      if (table.bit_length_[symbol] != length) continue;
+      remaining[length]--;
+
+      if (code >= code_limit) return Status::HuffmanTableError;
+      uint32_t leaf = reverse_bits(code >> (kMaxCodeLength - length), length);
+      for (; leaf < root_size; leaf += 1U << length) {
+        table.table_[leaf] = {static_cast<uint16_t>(symbol), static_cast<uint8_t>(length), 0};
+      }
+      code += 1U << (kMaxCodeLength - length);
+    }
+  }
+
+  uint32_t current_prefix = root_size;
+  uint32_t subtable_start = 0;
+  uint32_t subtable_bits  = 0;
+  for (uint32_t length = table_bits + 1; length <= kMaxCodeLength; length++) {
+    for (uint32_t symbol = 0; remaining[length] > 0; symbol++) {
+      if (table.bit_length_[symbol] != length) continue;
+
+      if (code >= code_limit) return Status::HuffmanTableError;
+      uint32_t prefix = code >> (kMaxCodeLength - table_bits);
+      if (prefix != current_prefix) {
+        subtable_bits = length - static_cast<uint32_t>(table_bits);
+        int32_t left  = 1 << subtable_bits;
+        while (table_bits + subtable_bits < kMaxCodeLength) {
+          left -= static_cast<int32_t>(remaining[table_bits + subtable_bits]);
+          if (left <= 0) break;
+          subtable_bits++;
+          left <<= 1;
+        }
+        current_prefix = prefix;
+        subtable_start = static_cast<uint32_t>(table.table_.size());
+        table.table_.resize(table.table_.size() + (size_t{1} << subtable_bits));
+        table.table_[reverse_bits(prefix, table_bits)] = {static_cast<uint16_t>(subtable_start),
+            static_cast<uint8_t>(table_bits), static_cast<uint8_t>(subtable_bits)};
+      }
+      remaining[length]--;
+
+      uint32_t sub_length = length - static_cast<uint32_t>(table_bits);
+      uint32_t leaf       = reverse_bits(code >> (kMaxCodeLength - length), sub_length);
+      for (; leaf < (1U << subtable_bits); leaf += 1U << sub_length) {
+        table.table_[subtable_start + leaf] = {
+            static_cast<uint16_t>(symbol), static_cast<uint8_t>(sub_length), 0};
+      }
+      code += 1U << (kMaxCodeLength - length);
+    }
+  }
+
+  return code == code_limit ? Status::Ok : Status::HuffmanTableError;
+}
+// NOLINTEND(readability-function-cognitive-complexity)
+
+template <typename F>
+double time_ns(size_t repeats, F&& function) {
+  auto start = Clock::now();
+  for (size_t i = 0; i < repeats; ++i) {
+    function();
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() /
+         static_cast<double>(repeats);
+}
+
+void bench_multi_symbol() {
+  huffman::HuffmanTable literals(kLiteralsBits, kNumLiterals);
+  literals.bit_length_ = make_literal_lengths();
+  if (literals.reset_table() != Status::Ok) {
+    std::printf("failed to build literal table\n");
+    return;
+  }
+  huffman::MultiSymbolTable pairs(kLiteralsBits);
+
+  constexpr size_t     kMaxCount = 1 << 18;
+  std::vector<uint8_t> stream    = make_stream(literals.bit_length_, kMaxCount);
+  std::vector<uint8_t> output(kMaxCount + huffman::MultiSymbolTable::kMaxSymbols);
+  volatile uint8_t     sink = 0;
+
+  std::printf("multi-symbol literal decoding (ns per block)\n");
+  std::printf("%10s %12s %12s %8s\n", "literals", "single", "build+multi", "ratio");
+
+  size_t crossover = 0;
+
+  for (size_t count = 256; count <= kMaxCount; count *= 2) {
+    size_t repeats = std::max<size_t>(8, (size_t{1} << 22) / count);
+
+    double single = time_ns(repeats, [&]() {
+      BitReader reader(stream);
+      for (size_t pos = 0; pos < count; ++pos) {
+        reader.refill_unchecked();
+        output[pos] = static_cast<uint8_t>(literals.decode(&reader));
+      }
+      sink = output[count - 1];
+    });
+
+    double multi = time_ns(repeats, [&]() {
+      pairs.build(literals, kNumLiterals);
+      BitReader reader(stream);
+      for (size_t pos = 0; pos < count;) {
+        reader.refill_unchecked();
+        const auto& pair = pairs.lookup(reader);
+        if (pair.count != 0) {
+          output[pos]     = pair.literals[0];
+          output[pos + 1] = pair.literals[1];
+          pos += pair.count;
+          reader.consume(pair.length);
+        } else {
+          output[pos++] = static_cast<uint8_t>(literals.decode(&reader));
+        }
+      }
+      sink = output[count - 1];
+    });
+
+    std::printf("%10zu %12.0f %12.0f %8.2f\n", count, single, multi, single / multi);
+    if (crossover == 0 && multi < single) crossover = count;
+  }
+  (void)sink;
+
+  if (crossover != 0) {
+    std::printf("crossover: multi-symbol wins from %zu literals per block\n", crossover);
+  } else {
+    std::printf("crossover: multi-symbol never wins\n");
+  }
+}
+
+/// Literal code lengths with a long tail past the root table, as in binaries.
+std::vector<uint8_t> make_deep_literal_lengths() {
+  // Split random leaves of a complete code until every literal and match symbol has a code.
+  std::mt19937         rng(3);
+  std::vector<uint8_t> lengths = {1, 1};
+  while (lengths.size() < 768) {
+    size_t leaf = rng() % lengths.size();
+    if (lengths[leaf] == huffman::HuffmanTable::kMaxCodeLength) continue;
+    lengths[leaf]++;
+    lengths.push_back(lengths[leaf]);
+  }
+  std::shuffle(lengths.begin(), lengths.end(), rng);
+  return lengths;
+}
+
+void bench_reset_table() {
+  struct Case {
+    const char*          name;
+    size_t               table_bits;
+    std::vector<uint8_t> lengths;
+  };
+
+  std::vector<uint8_t> text = make_literal_lengths();
+  text.resize(768);
+
+  const Case cases[] = {
+      {"literals (text)", kLiteralsBits, text},
+      {"literals (deep)", kLiteralsBits, make_deep_literal_lengths()},
+      {"pre-tree", 6, {4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 0, 0}},
+  };
+
+  std::printf("reset_table (ns per build)\n");
+  std::printf("%18s %12s %12s %8s\n", "code", "scanning", "sorting", "ratio");
+
+  for (const auto& test_case : cases) {
+    huffman::HuffmanTable table(test_case.table_bits, test_case.lengths.size());
+    table.bit_length_ = test_case.lengths;
+    if (table.reset_table() != Status::Ok || reset_table_scanning(table) != Status::Ok) {
+      std::printf("%18s: invalid code\n", test_case.name);
+      continue;
+    }
+
+    constexpr size_t kRepeats = 20000;
+    double scanning = time_ns(kRepeats, [&]() { (void)reset_table_scanning(table); });
+    double sorting  = time_ns(kRepeats, [&]() { (void)table.reset_table(); });
+    std::printf("%18s %12.0f %12.0f %8.2f\n", test_case.name, scanning, sorting, scanning / sorting);
+  }
+}
+
+}  // namespace
+
+int main() {
+  bench_reset_table();
+  std::printf("\n");
+  bench_multi_symbol();
+  return 0;
+}
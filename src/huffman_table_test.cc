@@ -0,0 +1,238 @@
+#include "huffman_table.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+using huffman::HuffmanTable;
+
+TEST(HuffmanTableTest, DecodesShortAndLongCodes) {
+  // Canonical codes: 0, 10, 110, 1110, 1111. With 2 root bits, the last three need a sub-table.
+  HuffmanTable table(2, 5);
+  table.bit_length_ = {1, 2, 3, 4, 4};
+  ASSERT_EQ(table.reset_table(), Status::Ok);
+
+  // Stream order: 1110 0 1111 10 110.
+  const uint8_t kTestData[] = {0x1B, 0xE7};
+  BitReader     reader(kTestData);
+  reader.refill();
+
+  EXPECT_EQ(table.decode(&reader), 3);
+  EXPECT_EQ(table.decode(&reader), 0);
+  EXPECT_EQ(table.decode(&reader), 4);
+  EXPECT_EQ(table.decode(&reader), 1);
+  EXPECT_EQ(table.decode(&reader), 2);
+  EXPECT_EQ(reader.read(1), 0);
+  EXPECT_FALSE(reader.overrun());
+}
+
+TEST(HuffmanTableTest, RejectsIncompleteCode) {
+  HuffmanTable table(2, 3);
+  table.bit_length_ = {1, 2, 0};
+  EXPECT_EQ(table.reset_table(), Status::HuffmanTableError);
+}
+
+TEST(HuffmanTableTest, RejectsOversubscribedCode) {
+  HuffmanTable table(2, 4);
+  table.bit_length_ = {1, 2, 2, 2};
+  EXPECT_EQ(table.reset_table(), Status::HuffmanTableError);
+
+  // Over-subscribed in the sub-table range.
+  table.bit_length_ = {1, 2, 3, 3};
+  table.bit_length_.push_back(3);
+  EXPECT_EQ(table.reset_table(), Status::HuffmanTableError);
+}
+
+TEST(HuffmanTableTest, RejectsEmptyCode) {
+  HuffmanTable table(6, 20);
+  EXPECT_EQ(table.reset_table(), Status::HuffmanTableError);
+}
+
+TEST(HuffmanTableTest, AcceptsOnlyCompleteCodes) {
+  std::mt19937 rng(5);
+  HuffmanTable table(6, 20);
+
+  for (int round = 0; round < 2000; ++round) {
+    // Kraft sum in units of 2^-16.
+    uint32_t kraft = 0;
+    for (auto& length : table.bit_length_) {
+      length = static_cast<uint8_t>(rng() % 3 == 0 ? 0 : rng() % 7 + 1);
+      if (length != 0) kraft += 1U << (16 - length);
+    }
+    EXPECT_EQ(table.reset_table() == Status::Ok, kraft == 1U << 16);
+  }
+}
+
+TEST(HuffmanTableTest, DecodesRandomCompleteCodes) {
+  std::mt19937 rng(7);
+
+  for (int round = 0; round < 200; ++round) {
+    // Split random leaves until the code has the requested number of symbols.
+    std::vector<uint8_t> lengths = {1, 1};
+    while (lengths.size() < 300) {
+      size_t leaf = rng() % lengths.size();
+      if (lengths[leaf] == HuffmanTable::kMaxCodeLength) continue;
+      lengths[leaf]++;
+      lengths.push_back(lengths[leaf]);
+    }
+    std::shuffle(lengths.begin(), lengths.end(), rng);
+
+    HuffmanTable table(9, lengths.size());
+    table.bit_length_ = lengths;
+    ASSERT_EQ(table.reset_table(), Status::Ok);
+
+    // Canonical codes: shorter first, then in symbol order.
+    std::vector<uint32_t> codes(lengths.size());
+    uint32_t              code = 0;
+    for (uint32_t length = 1; length <= HuffmanTable::kMaxCodeLength; ++length) {
+      for (size_t symbol = 0; symbol < lengths.size(); ++symbol) {
+        if (lengths[symbol] != length) continue;
+        codes[symbol] = code >> (HuffmanTable::kMaxCodeLength - length);
+        code += 1U << (HuffmanTable::kMaxCodeLength - length);
+      }
+    }
+
+    std::vector<uint32_t> symbols;
+    std::vector<uint8_t>  stream;
+    uint32_t              word = 0;
+    size_t                bits = 0;
+    for (int i = 0; i < 200; ++i) {
+      uint32_t symbol = rng() % lengths.size();
+      symbols.push_back(symbol);
+      for (uint32_t bit = lengths[symbol]; bit-- > 0;) {
+        word |= ((codes[symbol] >> bit) & 1) << bits;
+        if (++bits == 16) {
+          stream.push_back(static_cast<uint8_t>(word >> 8));
+          stream.push_back(static_cast<uint8_t>(word));
+          word = 0;
+          bits = 0;
+        }
+      }
+    }
+    stream.push_back(static_cast<uint8_t>(word >> 8));
+    stream.push_back(static_cast<uint8_t>(word));
+
+    BitReader reader(stream);
+    for (uint32_t symbol : symbols) {
+      reader.refill();
+      ASSERT_EQ(table.decode(&reader), symbol);
+    }
+    EXPECT_FALSE(reader.overrun());
+  }
+}
+
+TEST(MultiSymbolTableTest, MatchesSingleSymbolDecoding) {
+  std::mt19937 rng(11);
+  size_t       pairs = 0;
+
+  for (int round = 0; round < 100; ++round) {
+    // Random complete codes, from a few symbols with short codes to many with long ones.
+    std::vector<uint8_t> lengths = {1, 1};
+    size_t               size    = 4 + rng() % 400;
+    while (lengths.size() < size) {
+      size_t leaf = rng() % lengths.size();
+      if (lengths[leaf] == HuffmanTable::kMaxCodeLength) continue;
+      lengths[leaf]++;
+      lengths.push_back(lengths[leaf]);
+    }
+    std::shuffle(lengths.begin(), lengths.end(), rng);
+    auto num_literals = static_cast<uint32_t>(std::min<size_t>(size - size / 4, 256));
+
+    HuffmanTable table(12, lengths.size());
+    table.bit_length_ = lengths;
+    ASSERT_EQ(table.reset_table(), Status::Ok);
+    huffman::MultiSymbolTable multi(12);
+    multi.build(table, num_literals);
+
+    // At every bit offset of a random stream, a slot must hold what single lookups decode.
+    std::vector<uint8_t> stream(64);
+    for (auto& byte : stream) byte = static_cast<uint8_t>(rng());
+    BitReader reader(stream);
+    for (size_t bit = 0; bit < 256; ++bit, reader.consume(1)) {
+      reader.refill();
+      const auto& slot = multi.lookup(reader);
+
+      BitReader single = reader;
+      uint32_t  first  = table.decode(&single);
+      if (first >= num_literals || lengths[first] > 12) {
+        ASSERT_EQ(slot.count, 0);
+        continue;
+      }
+      ASSERT_GE(slot.count, 1);
+      EXPECT_EQ(slot.literals[0], first);
+
+      uint32_t second = table.decode(&single);
+      if (second < num_literals && lengths[first] + lengths[second] <= 12) {
+        ASSERT_EQ(slot.count, 2);
+        EXPECT_EQ(slot.literals[1], second);
+        EXPECT_EQ(slot.length, lengths[first] + lengths[second]);
+        pairs++;
+      } else {
+        EXPECT_EQ(slot.count, 1);
+        EXPECT_EQ(slot.length, lengths[first]);
+      }
+    }
+  }
+  EXPECT_GT(pairs, 0U);
+}
+
+TEST(HuffmanTableCacheTest, ReusesBuiltTables) {
+  huffman::HuffmanTableCache cache(2);
+  HuffmanTable               table(2, 5);
+
+  const std::vector<uint8_t> kFirst  = {1, 2, 3, 4, 4};
+  const std::vector<uint8_t> kSecond = {2, 2, 2, 3, 3};
+  const std::vector<uint8_t> kThird  = {3, 3, 2, 2, 2};
+
+  table.bit_length_ = kFirst;
+  ASSERT_EQ(cache.reset_table(&table), Status::Ok);
+  const auto first_table = table.table_;
+
+  table.bit_length_ = kSecond;
+  ASSERT_EQ(cache.reset_table(&table), Status::Ok);
+  const auto second_table = table.table_;
+
+  // Both codes are cached, and swapping between them gives back the same tables.
+  table.bit_length_ = kFirst;
+  ASSERT_EQ(cache.reset_table(&table), Status::Ok);
+  EXPECT_EQ(std::memcmp(table.table_.data(), first_table.data(), first_table.size() * sizeof(HuffmanTable::Entry)), 0);
+  table.bit_length_ = kSecond;
+  ASSERT_EQ(cache.reset_table(&table), Status::Ok);
+  EXPECT_EQ(std::memcmp(table.table_.data(), second_table.data(), second_table.size() * sizeof(HuffmanTable::Entry)), 0);
+  EXPECT_EQ(cache.stats().hits, 2);
+  EXPECT_EQ(cache.stats().misses, 2);
+
+  // The third code evicts the least recently used one.
+  table.bit_length_ = kThird;
+  ASSERT_EQ(cache.reset_table(&table), Status::Ok);
+  table.bit_length_ = kSecond;
+  ASSERT_EQ(cache.reset_table(&table), Status::Ok);
+  table.bit_length_ = kFirst;
+  ASSERT_EQ(cache.reset_table(&table), Status::Ok);
+  EXPECT_EQ(cache.stats().hits, 3);
+  EXPECT_EQ(cache.stats().misses, 4);
+  EXPECT_EQ(std::memcmp(table.table_.data(), first_table.data(), first_table.size() * sizeof(HuffmanTable::Entry)), 0);
+}
+
+TEST(HuffmanTableCacheTest, DoesNotCacheInvalidCodes) {
+  huffman::HuffmanTableCache cache;
+  HuffmanTable               table(2, 3);
+
+  table.bit_length_ = {1, 2, 0};
+  EXPECT_EQ(cache.reset_table(&table), Status::HuffmanTableError);
+  EXPECT_EQ(cache.reset_table(&table), Status::HuffmanTableError);
+  EXPECT_EQ(cache.stats().hits, 0);
+  EXPECT_EQ(cache.stats().misses, 2);
+
+  table.bit_length_ = {1, 2, 2};
+  EXPECT_EQ(cache.reset_table(&table), Status::Ok);
+  EXPECT_EQ(cache.reset_table(&table), Status::Ok);
+  EXPECT_EQ(cache.stats().hits, 1);
+}
+
+}  // namespace
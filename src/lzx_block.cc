@@ -2,21 +2,33 @@
 
 #include <algorithm>
 #include <cstring>
+#include <iterator>
 
-#include "huffman_decoder.hh"
+#include "block_decoder.hh"
 
-std::optional<std::span<const uint8_t>> LzxBlock::data() {
-  if (is_decompressed_) {
-    if (status_ == Status::Ok) return data_span_;
-    return std::nullopt;
+LzxBlock::~LzxBlock() {
+  if (cache_) cache_->erase(this);
+}
+
+std::optional<std::span<const uint8_t>> LzxBlock::data(size_t end) {
+  // Pinned first: another thread decompressing a block of the same cache may otherwise evict this
+  // one, and free its data, while it is checked or decoded here.
+  ScopedPin pin(this);
+  end = std::min(end, total_unpacked_size_);
+  if (is_decompressed_ || (decoder_ && end <= data_span_.size())) {
+    if (status_ != Status::Ok) return std::nullopt;
+    if (cache_ && decompressed_data_) cache_->touch(this);
+    return data_span_;
   }
-  is_decompressed_ = true;
 
   auto compression_type = node_.compression_info().mode();
   if (compression_type == lzx::CompressionInfo::Mode::kNone) {
+    is_decompressed_ = true;
     InputBuffer sub = in_file_;
     status_ = sub.read_span(total_unpacked_size_, data_span_);
     if (status_ == Status::Ok) {
+      if (!crcs_ready_) segment_crcs_.update(0, data_span_);
+      crcs_ready_ = true;
       return data_span_;
     }
     return std::nullopt;
@@ -24,45 +36,168 @@ std::optional<std::span<const uint8_t>> LzxBlock::data() {
 
   // Abort now if unknown compression algo.
   if (compression_type != lzx::CompressionInfo::Mode::kNormal) {
+    is_decompressed_ = true;
     status_ = Status::UnknownCompression;
     return std::nullopt;
   }
-  
-  huffman::HuffmanDecoder decoder;
-  decompressed_data_.emplace();
-  decompressed_data_->resize(total_unpacked_size_ + 256);
-
-  size_t decrunch_length = 0;
-  size_t pos = 0;
-
-  while (pos < total_unpacked_size_) {
-    if (decrunch_length <= 0) {
-      status_ = decoder.read_literal_table(&in_file_);
-      if (status_ != Status::Ok) return std::nullopt;
-      decrunch_length = decoder.decrunch_length();
+
+  if (!decoder_) {
+    std::span<const uint8_t> packed;
+    InputBuffer sub = in_file_;
+    status_ = sub.read_span(sub.available(), packed);
+    if (status_ != Status::Ok) {
+      is_decompressed_ = true;
+      return std::nullopt;
     }
 
-    size_t target_size = pos + decrunch_length;
-    target_size = std::min(target_size, total_unpacked_size_);
+    decoder_ = std::make_unique<huffman::BlockDecoder>(packed, total_unpacked_size_);
+    decompressed_data_.emplace();
+    decompressed_data_->resize(total_unpacked_size_ + huffman::BlockDecoder::kOutputSlack);
+    decoder_crcs_ = !crcs_ready_;
+    if (decoder_crcs_) segment_crcs_.reset();
+    if (cache_) cache_->insert(this, total_unpacked_size_);
+  } else if (cache_) {
+    cache_->touch(this);
+  }
 
-    size_t old_pos = pos;
-    status_ = decoder.decrunch(&in_file_, *decompressed_data_, pos, target_size);
-    if (status_ != Status::Ok) return std::nullopt;
+  status_ = decoder_->decode_to(*decompressed_data_, end, decoder_crcs_ ? &segment_crcs_ : nullptr);
+  table_cache_stats_ = decoder_->table_cache_stats();
+  if (status_ != Status::Ok) {
+    release();
+    is_decompressed_ = true;
+    return std::nullopt;
+  }
 
-    size_t decoded_bytes = pos - old_pos;
-    if (decoded_bytes == 0 && in_file_.is_eof()) {
-      status_ = Status::UnexpectedEof;
-      return std::nullopt;
-    }
-    
-    if (decoded_bytes > decrunch_length) {
-      decrunch_length = 0;
-    } else {
-      decrunch_length -= decoded_bytes;
-    }
+  data_span_ = std::span<const uint8_t>(decompressed_data_->data(), decoder_->decoded());
+  if (data_span_.size() == total_unpacked_size_) {
+    is_decompressed_ = true;
+    decoder_.reset();
+    if (decoder_crcs_) crcs_ready_ = true;
+    decoder_crcs_ = false;
+    decompressed_data_->resize(total_unpacked_size_);
   }
-  status_ = Status::Ok;
-  decompressed_data_->resize(total_unpacked_size_);
-  data_span_ = std::span<const uint8_t>(decompressed_data_->data(), total_unpacked_size_);
   return data_span_;
-}
\ No newline at end of file
+}
+
+void LzxBlock::release() {
+  if (cache_) cache_->erase(this);
+  free_data();
+}
+
+void LzxBlock::pin() {
+  if (cache_) cache_->pin(this);
+}
+
+void LzxBlock::unpin() {
+  if (cache_) cache_->unpin(this);
+}
+
+void LzxBlock::free_data() {
+  decoder_.reset();
+  decoder_crcs_ = false;
+  decompressed_data_.reset();
+  data_span_ = {};
+  checkpoints_ = {};
+  // A failed block keeps reporting its error rather than being decompressed again.
+  if (status_ == Status::Ok) is_decompressed_ = false;
+}
+
+std::optional<uint32_t> LzxBlock::segment_crc(size_t index) const {
+  if (crcs_ready_) return segment_crcs_.sum(index);
+  if (decoder_crcs_ && segment_crcs_.end(index) <= data_span_.size()) return segment_crcs_.sum(index);
+  return std::nullopt;
+}
+
+Status LzxBlock::checksum() {
+  if (crcs_ready_) return Status::Ok;
+  if (decoder_) return data() ? Status::Ok : status_;
+
+  size_t position = 0;
+  segment_crcs_.reset();
+  status_ = stream([&](std::span<const uint8_t> chunk) {
+    segment_crcs_.update(position, chunk);
+    position += chunk.size();
+    return Status::Ok;
+  });
+  crcs_ready_ = status_ == Status::Ok;
+  return status_;
+}
+
+Status LzxBlock::read(size_t offset, std::span<uint8_t> out) {
+  if (offset > total_unpacked_size_ || out.size() > total_unpacked_size_ - offset) {
+    return Status::OutOfRange;
+  }
+  size_t    end = offset + out.size();
+  ScopedPin pin(this);
+
+  if (is_decompressed_ || (decoder_ && end <= data_span_.size())) {
+    TRY(status_);
+    std::memcpy(out.data(), data_span_.data() + offset, out.size());
+    return Status::Ok;
+  }
+
+  auto compression_type = node_.compression_info().mode();
+  InputBuffer sub = in_file_;
+  if (compression_type == lzx::CompressionInfo::Mode::kNone) {
+    TRY(sub.skip(offset));
+    return sub.read_into(out.data(), out.size());
+  }
+  if (compression_type != lzx::CompressionInfo::Mode::kNormal) return Status::UnknownCompression;
+
+  std::span<const uint8_t> packed;
+  TRY(sub.read_span(sub.available(), packed));
+
+  // The last checkpoint at or before the offset.
+  const huffman::BlockDecoder::Checkpoint* from = nullptr;
+  auto after = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), offset,
+      [](size_t offset, const auto& checkpoint) { return offset < checkpoint.offset; });
+  if (after != checkpoints_.begin()) from = &*std::prev(after);
+
+  size_t saved    = checkpoints_.size();
+  size_t position = (from != nullptr) ? from->offset : 0;  // Block offset of the chunk.
+  huffman::BlockDecoder decoder(packed, total_unpacked_size_);
+  Status status = decoder.stream([&](std::span<const uint8_t> chunk) {
+    size_t begin = std::max(offset, position);
+    size_t stop  = std::min(end, position + chunk.size());
+    if (begin < stop) {
+      std::memcpy(out.data() + (begin - offset), chunk.data() + (begin - position), stop - begin);
+    }
+    position += chunk.size();
+    return Status::Ok;
+  }, end, from, &checkpoints_);
+  table_cache_stats_ = decoder.table_cache_stats();
+
+  // New checkpoints are appended; they count against the cache budget like decompressed data.
+  size_t bytes = 0;
+  for (size_t index = saved; index < checkpoints_.size(); ++index) {
+    bytes += sizeof(checkpoints_[index]) + checkpoints_[index].window.size();
+  }
+  if (cache_ && bytes > 0) cache_->charge(this, bytes);
+  return status;
+}
+
+Status LzxBlock::stream(const huffman::ChunkConsumer& consumer, size_t end) {
+  ScopedPin pin(this);
+  end = std::min(end, total_unpacked_size_);
+  if (is_decompressed_ || (decoder_ && end <= data_span_.size())) {
+    TRY(status_);
+    return consumer(data_span_.first(std::min(end, data_span_.size())));
+  }
+
+  auto compression_type = node_.compression_info().mode();
+  InputBuffer sub = in_file_;
+  if (compression_type == lzx::CompressionInfo::Mode::kNone) {
+    std::span<const uint8_t> stored;
+    TRY(sub.read_span(total_unpacked_size_, stored));
+    return consumer(stored.first(end));
+  }
+  if (compression_type != lzx::CompressionInfo::Mode::kNormal) return Status::UnknownCompression;
+
+  std::span<const uint8_t> packed;
+  TRY(sub.read_span(sub.available(), packed));
+
+  huffman::BlockDecoder decoder(packed, total_unpacked_size_);
+  Status status = decoder.stream(consumer, end);
+  table_cache_stats_ = decoder.table_cache_stats();
+  return status;
+}
@@ -1,30 +1,133 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 #include <optional>
 #include <span>
 #include <vector>
 
+#include "block_cache.hh"
+#include "block_decoder.hh"
+#include "crc.hh"
 #include "error.hh"
+#include "huffman_table.hh"
 #include "lzx_handle.hh"
 #include "mmap_buffer.hh"
 
 class LzxBlock {
 public:
+  /**
+   * @brief Pins a block for the lifetime of this object; see `pin()`.
+   */
+  class ScopedPin {
+   public:
+    explicit ScopedPin(LzxBlock* block) : block_(block) { block_->pin(); }
+    ~ScopedPin() { block_->unpin(); }
+
+    ScopedPin(const ScopedPin&)            = delete;
+    ScopedPin& operator=(const ScopedPin&) = delete;
+
+   private:
+    LzxBlock* block_;
+  };
+
   /**
    * @brief Constructs an LzxBlock.
    * @param n The LZX entry metadata associated with this block.
    * @param in The input buffer containing the compressed data.
    * @param unpacked_sz The total expected size of the decompressed data.
+   * @param index The position of the block in the archive, counting from 0.
+   * @param cache The cache holding the decompressed data, or nullptr to keep it until `release()`.
+   */
+  LzxBlock(lzx::Entry n, InputBuffer in, size_t unpacked_sz, size_t index = 0,
+      std::shared_ptr<BlockCache> cache = nullptr)
+      : node_(std::move(n)), in_file_(in), total_unpacked_size_(unpacked_sz), index_(index),
+        cache_(std::move(cache)) {}
+
+  ~LzxBlock();
+
+  LzxBlock(const LzxBlock&)            = delete;
+  LzxBlock& operator=(const LzxBlock&) = delete;
+
+  /**
+   * @brief Decompresses the block data up to `end` if not already done and returns a span to it.
+   *
+   * Decoding stops once `end` bytes are available, and the decoder state is kept: a later call
+   * with a larger `end` resumes where this one stopped. A file at the start of a large merged
+   * group is then read without decoding the rest of the group.
+   *
+   * With a cache, the block is pinned while it decodes, so that other threads decompressing
+   * blocks of the same cache cannot evict it. The span stays valid until another block of the
+   * cache is decompressed and evicts this one, unless the block is pinned: pin it while reading
+   * the span if other threads share the cache.
+   *
+   * @param end The number of bytes needed; the whole block by default.
+   * @return An optional span containing at least the first `end` bytes of decompressed data.
    */
-  LzxBlock(lzx::Entry n, InputBuffer in, size_t unpacked_sz)
-      : node_(std::move(n)), in_file_(in), total_unpacked_size_(unpacked_sz) {}
+  std::optional<std::span<const uint8_t>> data(size_t end = SIZE_MAX);
 
   /**
-   * @brief Decompresses the block data if not already done and returns a span to it.
-   * @return An optional span containing the decompressed data.
+   * @brief Frees the decompressed data; a later `data()` decompresses the block again.
+   *
+   * The checkpoints of `read()` are freed too; the status and the segment CRC-32s are kept. Spans
+   * returned by `data()` become invalid.
    */
-  std::optional<std::span<const uint8_t>> data();
+  void release();
+
+  /**
+   * @brief Keeps the cache from evicting the block until a matching `unpin()`.
+   *
+   * Pin a block before handing it to other threads, so that their spans of its data stay valid.
+   * Without a cache, does nothing.
+   */
+  void pin();
+
+  /**
+   * @brief Undoes one `pin()`.
+   */
+  void unpin();
+
+  /**
+   * @brief Decompresses the block in chunks, keeping only a fixed-size window in memory.
+   *
+   * Unlike `data()`, nothing is retained: streaming the block again decompresses it again. If
+   * `data()` has already decompressed the block, its data is passed on as a single chunk.
+   *
+   * @param consumer Receives the decompressed data, in order.
+   * @param end Stop once this many bytes have been passed on; the whole block by default.
+   * @return Status indicating success, the consumer's error, or the specific error encountered.
+   */
+  Status stream(const huffman::ChunkConsumer& consumer, size_t end = SIZE_MAX);
+
+  /**
+   * @brief Copies a range of the decompressed data, decoding as little of the block as possible.
+   *
+   * Data already decompressed by `data()` is copied. Otherwise the block is streamed from the
+   * nearest checkpoint before `offset`; streaming saves checkpoints as it goes, so the first read
+   * far into a block pays for the decoding up to it and later reads near it do not. Nothing else is
+   * retained.
+   *
+   * Each checkpoint holds a copy of the decoder window, about 64 KiB per
+   * `BlockDecoder::kCheckpointInterval` of the block read through. They are kept until `release()`
+   * or, with a cache, until the block is evicted; the cache counts them against its budget.
+   *
+   * @param offset Offset of the range in the decompressed data.
+   * @param out Receives the range; its size is the length of the range.
+   * @return Status indicating success, Status::OutOfRange if the range ends past the block, or the
+   *         specific error encountered.
+   */
+  Status read(size_t offset, std::span<uint8_t> out);
+
+  /**
+   * @brief Computes the CRC-32s of the segments without keeping the decompressed data.
+   *
+   * The block is streamed through the decoder's window unless `data()` or a previous call already
+   * computed the CRC-32s, so memory use does not depend on the size of the block. A block that
+   * `data()` has partly decoded is finished instead, as its buffer is already allocated.
+   *
+   * @return Status indicating success or the specific error encountered.
+   */
+  Status checksum();
 
   /**
    * @brief Gets the status of the last decompression operation.
@@ -38,19 +141,69 @@ public:
    */
   size_t packed_size() const { return node_.pack_size(); }
 
+  /**
+   * @brief Gets the position of the block in the archive.
+   * @return The number of blocks before this one.
+   */
+  size_t index() const { return index_; }
+
   /**
    * @brief Gets the total unpacked (decompressed) size of the block.
    * @return The total unpacked size in bytes.
    */
   size_t total_unpacked_size() const { return total_unpacked_size_; }
 
+  /**
+   * @brief Registers a range of the decompressed data whose CRC-32 should be computed.
+   *
+   * The CRC-32s are computed while decompressing, as the data is produced. Ranges must be added
+   * before the block is decompressed.
+   *
+   * @param offset Offset of the range in the decompressed data.
+   * @param length Length of the range in bytes.
+   * @return The index of the range, for `segment_crc()`.
+   */
+  size_t add_segment(size_t offset, size_t length) {
+    return segment_crcs_.add_segment(offset, length);
+  }
+
+  /**
+   * @brief Gets the CRC-32 of a range registered with `add_segment()`.
+   * @param index The index of the range.
+   * @return The CRC-32, or std::nullopt if neither `data()` nor `checksum()` has produced the
+   *         whole range yet.
+   */
+  std::optional<uint32_t> segment_crc(size_t index) const;
+
+  /**
+   * @brief Gets the decode table cache counters of the last decompression.
+   * @return The number of Huffman tables reused and built while decompressing this block.
+   */
+  huffman::HuffmanTableCache::Stats table_cache_stats() const { return table_cache_stats_; }
+
 private:
+  friend class BlockCache;
+
+  // Frees the decompressed data without notifying the cache.
+  void free_data();
+
   lzx::Entry node_;
   InputBuffer in_file_;
   size_t total_unpacked_size_;
+  size_t index_;
+  std::shared_ptr<BlockCache> cache_;
 
   std::optional<std::vector<uint8_t>> decompressed_data_;
+  // Kept while `data()` has decoded only a prefix of the block.
+  std::unique_ptr<huffman::BlockDecoder> decoder_;
+  // Whether the decoder feeds `segment_crcs_`, which then cover the decoded prefix.
+  bool decoder_crcs_ = false;
   std::span<const uint8_t> data_span_;
+  // Saved by `read()`, in offset order; freed with the data.
+  std::vector<huffman::BlockDecoder::Checkpoint> checkpoints_;
   Status status_ = Status::Ok;
+  huffman::HuffmanTableCache::Stats table_cache_stats_;
+  crc::SegmentCrc32 segment_crcs_;
   bool is_decompressed_ = false;
+  bool crcs_ready_ = false;
 };
\ No newline at end of file
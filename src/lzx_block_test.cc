@@ -0,0 +1,129 @@
+#include "lzx_block.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "extractor.hh"
+#include "test_archive.hh"
+#include "test_encoder.hh"
+
+namespace {
+
+class LzxBlockTest : public ArchiveTest {
+ protected:
+  static constexpr size_t kSize = 400000;
+
+  // A merged group: "a" at the start, "b" in the middle and "c" at the end.
+  std::map<std::string, LzxEntry> open_group() {
+    auto packed = test_encoder::encode_random(kSize, 50000, expected_, 11);
+
+    TestArchive archive;
+    archive.add_block({{"a", slice(0, 2000)}, {"b", slice(2000, 200000)}, {"c", slice(200000, kSize)}},
+        packed);
+    return open(archive);
+  }
+
+  std::vector<uint8_t> slice(size_t begin, size_t end) const {
+    return std::vector<uint8_t>(expected_.begin() + begin, expected_.begin() + end);
+  }
+
+  static std::vector<uint8_t> copy(std::span<const uint8_t> data) {
+    return std::vector<uint8_t>(data.begin(), data.end());
+  }
+
+  std::vector<uint8_t> expected_;
+};
+
+TEST_F(LzxBlockTest, DecodesOnlyUpToRequestedSegment) {
+  auto        entries = open_group();
+  const auto& a       = entries.at("a").segments().front();
+  auto        block   = a.block();
+
+  EXPECT_EQ(copy(a.data()), slice(0, 2000));
+  EXPECT_LT(block->data(0)->size(), kSize / 2);
+  EXPECT_TRUE(a.crc().has_value());
+  EXPECT_FALSE(entries.at("c").segments().front().crc().has_value());
+
+  // Resumes from the saved state rather than starting over.
+  EXPECT_EQ(copy(entries.at("b").segments().front().data()), slice(2000, 200000));
+  EXPECT_LT(block->data(0)->size(), kSize);
+  EXPECT_EQ(copy(entries.at("c").segments().front().data()), slice(200000, kSize));
+  EXPECT_EQ(block->data(0)->size(), kSize);
+
+  crc::Crc32 crc;
+  crc.calc(expected_.data() + 200000, kSize - 200000);
+  EXPECT_EQ(entries.at("c").segments().front().crc(), crc.sum());
+}
+
+TEST_F(LzxBlockTest, RestartsAfterReleaseOfPartialDecode) {
+  auto        entries = open_group();
+  const auto& b       = entries.at("b").segments().front();
+
+  EXPECT_EQ(copy(b.data()), slice(2000, 200000));
+  b.block()->release();
+  EXPECT_FALSE(entries.at("c").segments().front().crc().has_value());
+  EXPECT_EQ(copy(entries.at("c").segments().front().data()), slice(200000, kSize));
+  EXPECT_TRUE(b.crc().has_value());
+}
+
+TEST_F(LzxBlockTest, ChecksumFinishesPartialDecode) {
+  auto        entries = open_group();
+  const auto& a       = entries.at("a").segments().front();
+
+  a.data();
+  EXPECT_EQ(a.block()->checksum(), Status::Ok);
+  EXPECT_EQ(a.block()->data(0)->size(), kSize);
+  EXPECT_TRUE(entries.at("c").segments().front().crc().has_value());
+}
+
+TEST_F(LzxBlockTest, ExtractsFirstFileOfGroup) {
+  auto entries = open_group();
+
+  const LzxEntry* selected[] = {&entries.at("a")};
+  for (Status status : Extractor(2).extract(selected)) EXPECT_EQ(status, Status::Ok);
+  EXPECT_EQ(read_file("a"), slice(0, 2000));
+}
+
+TEST_F(LzxBlockTest, ReadsRangesFromCheckpoints) {
+  const size_t         size = 3 * huffman::BlockDecoder::kCheckpointInterval;
+  std::vector<uint8_t> expected;
+  auto                 packed = test_encoder::encode_random(size, 60000, expected, 12);
+
+  TestArchive archive;
+  archive.add_block({{"image", expected}}, packed);
+  auto entries = open(archive);
+  const auto& image = entries.at("image");
+
+  const size_t kOffsets[] = {size - 100, 10, huffman::BlockDecoder::kCheckpointInterval + 7, size / 2};
+  for (size_t offset : kOffsets) {
+    std::vector<uint8_t> out(100);
+    size_t               count = 0;
+    ASSERT_EQ(image.read(offset, out, count), Status::Ok);
+    EXPECT_EQ(count, 100U);
+    EXPECT_TRUE(std::equal(out.begin(), out.end(), expected.begin() + offset)) << offset;
+  }
+
+  // Short read at the end of the file, none past it.
+  std::vector<uint8_t> out(100);
+  size_t               count = 0;
+  ASSERT_EQ(image.read(size - 30, out, count), Status::Ok);
+  EXPECT_EQ(count, 30U);
+  EXPECT_TRUE(std::equal(out.begin(), out.begin() + 30, expected.end() - 30));
+  ASSERT_EQ(image.read(size + 1, out, count), Status::Ok);
+  EXPECT_EQ(count, 0U);
+}
+
+TEST_F(LzxBlockTest, ReadsWithinMergedGroup) {
+  auto entries = open_group();
+
+  std::vector<uint8_t> out(5000);
+  size_t               count = 0;
+  ASSERT_EQ(entries.at("c").read(1000, out, count), Status::Ok);
+  EXPECT_EQ(count, out.size());
+  EXPECT_EQ(out, slice(201000, 206000));
+  EXPECT_FALSE(entries.at("c").segments().front().crc().has_value());
+}
+
+}  // namespace
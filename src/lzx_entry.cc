@@ -1,14 +1,18 @@
 #include "lzx_entry.hh"
 
+#include <algorithm>
+
 LzxFileSegment::LzxFileSegment(std::shared_ptr<LzxBlock> block, size_t decompressed_offset, size_t decompressed_length)
-    : block_(std::move(block)), decompressed_offset_(decompressed_offset), decompressed_length_(decompressed_length) {}
+    : block_(std::move(block)), decompressed_offset_(decompressed_offset), decompressed_length_(decompressed_length) {
+  if (block_) crc_index_ = block_->add_segment(decompressed_offset_, decompressed_length_);
+}
 
 std::shared_ptr<LzxBlock> LzxFileSegment::block() const {
   return block_;
 }
 
 std::span<const uint8_t> LzxFileSegment::data() const {
-  if (auto data = block_->data()) {
+  if (auto data = block_->data(decompressed_offset_ + decompressed_length_)) {
     return data->subspan(decompressed_offset_, decompressed_length_);
   }
   return {};
@@ -18,10 +22,19 @@ Status LzxFileSegment::status() const {
   return block_->status();
 }
 
+size_t LzxFileSegment::decompressed_offset() const {
+  return decompressed_offset_;
+}
+
 size_t LzxFileSegment::decompressed_length() const {
   return decompressed_length_;
 }
 
+std::optional<uint32_t> LzxFileSegment::crc() const {
+  if (!block_) return std::nullopt;
+  return block_->segment_crc(crc_index_);
+}
+
 static std::filesystem::path from_latin1(const std::string& latin1) {
 #ifdef _WIN32
   std::wstring wide;
@@ -59,6 +72,12 @@ const std::filesystem::path& LzxEntry::path() const {
   return path_;
 }
 
+bool LzxEntry::has_safe_path() const {
+  // Entry names come from the archive; none may place a file outside the destination.
+  if (path_.has_root_path()) return false;
+  return std::none_of(path_.begin(), path_.end(), [](const auto& part) { return part == ".."; });
+}
+
 const lzx::Entry& LzxEntry::metadata() const {
   return metadata_;
 }
@@ -67,6 +86,24 @@ const std::vector<LzxFileSegment>& LzxEntry::segments() const {
   return segments_;
 }
 
+Status LzxEntry::read(size_t offset, std::span<uint8_t> out, size_t& count) const {
+  count = 0;
+
+  size_t start = 0;  // File offset of the segment.
+  for (const auto& segment : segments_) {
+    size_t length   = segment.decompressed_length();
+    size_t position = offset + count;
+    if (count < out.size() && position >= start && position < start + length) {
+      size_t chunk = std::min(start + length - position, out.size() - count);
+      size_t block_offset = segment.decompressed_offset() + (position - start);
+      TRY(segment.block()->read(block_offset, out.subspan(count, chunk)));
+      count += chunk;
+    }
+    start += length;
+  }
+  return Status::Ok;
+}
+
 std::optional<size_t> LzxEntry::pack_size() const {
   if (metadata_.flags().is_merged()) {
     size_t total_guessed = 0;
@@ -27,7 +27,7 @@ public:
   std::shared_ptr<LzxBlock> block() const;
 
   /**
-   * @brief Gets the segment of the block data.
+   * @brief Gets the segment of the block data, decoding the block only as far as the segment ends.
    * @return The span to the segment data.
    */
   std::span<const uint8_t> data() const;
@@ -38,16 +38,29 @@ public:
    */
   Status status() const;
 
+  /**
+   * @brief Gets the offset of the segment in the decompressed block.
+   * @return The decompressed offset.
+   */
+  size_t decompressed_offset() const;
+
   /**
    * @brief Gets the decompressed length.
    * @return The decompressed length.
    */
   size_t decompressed_length() const;
 
+  /**
+   * @brief Gets the CRC-32 of the segment data, computed by the block while decompressing.
+   * @return The CRC-32, or std::nullopt if the block has not been successfully decompressed.
+   */
+  std::optional<uint32_t> crc() const;
+
 private:
   std::shared_ptr<LzxBlock> block_;
   size_t decompressed_offset_{0};
   size_t decompressed_length_{0};
+  size_t crc_index_{0};
 };
 
 class LzxEntry {
@@ -72,6 +85,12 @@ public:
    */
   const std::filesystem::path& path() const;
 
+  /**
+   * @brief Checks that the path stays inside the directory it is extracted to.
+   * @return false if the path is absolute or has a `..` component.
+   */
+  bool has_safe_path() const;
+
   /**
    * @brief Gets the metadata for the entry.
    * @return The lzx::Entry metadata.
@@ -84,6 +103,24 @@ public:
    */
   const std::vector<LzxFileSegment>& segments() const;
 
+  /**
+   * @brief Reads part of the file, like `pread()`, without decoding whole blocks.
+   *
+   * Blocks are decoded from their nearest checkpoint; see `LzxBlock::read()`. The data is not
+   * checked against the file CRC-32, which covers the whole file. Not thread-safe for entries
+   * sharing a block.
+   *
+   * Checkpoints cost about 64 KiB of memory per MiB of each block read through, held until the
+   * block is released or evicted from its cache, whose budget counts them. Without a cache, call
+   * `LzxBlock::release()` on blocks no longer read to free them.
+   *
+   * @param offset Offset in the file of the first byte to read.
+   * @param out Receives the data.
+   * @param count Number of bytes read: less than `out.size()` at the end of the file, 0 past it.
+   * @return Status indicating success or the specific error encountered.
+   */
+  Status read(size_t offset, std::span<uint8_t> out, size_t& count) const;
+
   /**
    * @brief Calculates the estimated pack size for the entry.
    * @return The pack size if it can be determined, std::nullopt otherwise.
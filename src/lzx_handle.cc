@@ -1,5 +1,6 @@
 #include "lzx_handle.hh"
 
+#include <cstddef>
 #include <format>
 #include <iostream>
 
@@ -7,32 +8,53 @@
 
 namespace lzx {
 
-Status Entry::from_buffer(InputBuffer* buffer, std::unique_ptr<Entry>& out) {
-  if (buffer->is_eof()) return Status::Ok;
+uint32_t Header::compute_crc(std::string_view filename, std::string_view comment) const {
+  // The stored CRC was computed with its own field zeroed.
+  static constexpr uint8_t kZeroCrc[sizeof(header_crc_)]{};
+  const auto*              bytes     = reinterpret_cast<const uint8_t*>(this);
+  const size_t             crc_start = offsetof(Header, header_crc_);
+  const size_t             crc_end   = crc_start + sizeof(header_crc_);
 
-  auto   result = std::make_unique<Entry>();
-  TRY(buffer->read_into(&result->metadata_, sizeof(result->metadata_)));
-
-  uint32_t const header_crc     = result->metadata_.header_crc_.value();
-  result->metadata_.header_crc_ = 0;
+  crc::Crc32 crc_calc;
+  crc_calc.calc(bytes, crc_start);
+  crc_calc.calc(kZeroCrc, sizeof(kZeroCrc));
+  crc_calc.calc(bytes + crc_end, sizeof(Header) - crc_end);
+  crc_calc.calc(filename.data(), filename.size());
+  crc_calc.calc(comment.data(), comment.size());
+  return crc_calc.sum();
+}
 
-  std::string_view filename;
-  TRY(buffer->read_string_view(result->metadata_.filename_length_, filename));
-  result->filename_ = filename;
+Status HeaderView::from_buffer(InputBuffer* buffer, HeaderView& out) {
+  std::span<const uint8_t> bytes;
+  TRY(buffer->read_span(sizeof(Header), bytes));
+  out.header = reinterpret_cast<const Header*>(bytes.data());
+  out.packed = {};
 
-  std::string_view comment;
-  TRY(buffer->read_string_view(result->metadata_.comment_length_, comment));
-  result->comment_ = comment;
+  TRY(buffer->read_string_view(out.header->filename_length(), out.filename));
+  TRY(buffer->read_string_view(out.header->comment_length(), out.comment));
 
-  crc::Crc32 crc_calc;
-  crc_calc.calc(&result->metadata_, sizeof(result->metadata_));
-  crc_calc.calc(result->filename_.data(), result->filename_.size());
-  crc_calc.calc(result->comment_.data(), result->comment_.size());
-  if (crc_calc.sum() != header_crc) {
+  if (out.header->compute_crc(out.filename, out.comment) != out.header->header_crc()) {
     return Status::ChecksumInvalid;
   }
+  return Status::Ok;
+}
+
+Status HeaderIterator::next(HeaderView& out) {
+  TRY(HeaderView::from_buffer(&buffer_, out));
+  return buffer_.read_span(out.header->pack_size(), out.packed);
+}
+
+Status Entry::from_buffer(InputBuffer* buffer, std::unique_ptr<Entry>& out) {
+  if (buffer->is_eof()) return Status::Ok;
+
+  HeaderView view;
+  TRY(HeaderView::from_buffer(buffer, view));
 
-  out = std::move(result);
+  auto result       = std::make_unique<Entry>();
+  result->metadata_ = *view.header;
+  result->filename_ = view.filename;
+  result->comment_  = view.comment;
+  out               = std::move(result);
   return Status::Ok;
 }
 
@@ -4,6 +4,9 @@
 #include <cstdint>
 #include <format>
 #include <memory>
+#include <span>
+#include <string>
+#include <string_view>
 
 #include "error.hh"
 #include "mmap_buffer.hh"
@@ -144,38 +147,203 @@ class Flags {
 static_assert(sizeof(CompressionInfo) == 1);
 
 
+/// @brief The fixed part of an entry header as stored in the archive, followed there by the filename
+/// and the comment. Byte-aligned, so it can be read in place from a mapped archive.
+class Header {
+ public:
+  /**
+   * @brief Gets the unpack size of the entry.
+   * @return The unpacked size in bytes.
+   */
+  constexpr size_t unpack_size() const {
+    return unpack_size_.value();
+  }
+
+  /**
+   * @brief Gets the packed size of the entry.
+   * @return The packed size in bytes.
+   */
+  constexpr size_t pack_size() const {
+    return pack_size_.value();
+  }
+
+  /**
+   * @brief Gets the datestamp of the entry.
+   * @return The DateStamp object.
+   */
+  constexpr const DateStamp& datestamp() const {
+    return date_;
+  }
+
+  /**
+   * @brief Gets the data CRC-32 of the entry.
+   * @return The CRC-32 value.
+   */
+  constexpr uint32_t data_crc() const {
+    return data_crc_.value();
+  }
+
+  /**
+   * @brief Gets the CRC-32 of the header, filename and comment, computed with this field zeroed.
+   * @return The CRC-32 value.
+   */
+  constexpr uint32_t header_crc() const {
+    return header_crc_.value();
+  }
+
+  /**
+   * @brief Gets the compression info of the entry.
+   * @return The CompressionInfo object.
+   */
+  constexpr CompressionInfo compression_info() const {
+    return compression_info_;
+  }
+
+  /**
+   * @brief Gets the protection bits (attributes) of the entry.
+   * @return The ProtectionBits object.
+   */
+  constexpr ProtectionBits attributes() const {
+    return attributes_;
+  }
+
+  /**
+   * @brief Gets the flags of the entry.
+   * @return The Flags object.
+   */
+  constexpr Flags flags() const {
+    return flags_;
+  }
+
+  /**
+   * @brief Gets the length of the filename following the header.
+   * @return The length in bytes.
+   */
+  constexpr size_t filename_length() const {
+    return filename_length_;
+  }
+
+  /**
+   * @brief Gets the length of the comment following the filename.
+   * @return The length in bytes.
+   */
+  constexpr size_t comment_length() const {
+    return comment_length_;
+  }
+
+  /**
+   * @brief Computes the header CRC-32, as stored in `header_crc()`, without modifying the header.
+   * @param filename The filename following the header.
+   * @param comment The comment following the filename.
+   * @return The CRC-32 value.
+   */
+  uint32_t compute_crc(std::string_view filename, std::string_view comment) const;
+
+ private:
+  ProtectionBits                       attributes_;        // File protection modes
+  uint8_t                              reserved1_;         // Reserved
+  Value<uint32_t, std::endian::little> unpack_size_;       // Unpacked size
+  Value<uint32_t, std::endian::little> pack_size_;         // Packed size
+  uint8_t                              machine_type_;      // Machine type
+  CompressionInfo                      compression_info_;  // Compression info
+  Flags                                flags_;             // Flags
+  uint8_t                              reserved2_;         // Reserved
+  uint8_t                              comment_length_;    // Comment length
+  uint8_t                              extract_ver_;       // Version needed to extract
+  uint8_t                              reserved3_[2];      // Reserved
+  DateStamp                            date_;              // Packed date
+  Value<uint32_t, std::endian::little> data_crc_;          // Data CRC
+  Value<uint32_t, std::endian::little> header_crc_;        // Header CRC
+  uint8_t                              filename_length_;   // Filename length
+} PACKED;
+static_assert(sizeof(Header) == 31);
+static_assert(alignof(Header) == 1);
+
+
+/// @brief An entry header read in place: every field points into the archive buffer.
+struct HeaderView {
+  const Header*            header{};  ///< The fixed part of the header.
+  std::string_view         filename;  ///< The filename, as stored.
+  std::string_view         comment;   ///< The comment, as stored.
+  std::span<const uint8_t> packed;    ///< The packed data following the header; see HeaderIterator.
+
+  /**
+   * @brief Reads a header, its filename and its comment, and checks the header CRC-32.
+   *
+   * `packed` is left empty and the buffer is left at the packed data.
+   *
+   * @param buffer The input buffer to read from; must outlive the view.
+   * @param out The view.
+   * @return Status indicating success or the specific error encountered.
+   */
+  static Status from_buffer(InputBuffer* buffer, HeaderView& out);
+};
+
+
+/// @brief Walks the headers of an archive without copying them or allocating.
+class HeaderIterator {
+ public:
+  /**
+   * @brief Constructs a new HeaderIterator.
+   * @param buffer The archive contents following the archive header; must outlive the views.
+   */
+  explicit HeaderIterator(InputBuffer buffer) : buffer_(buffer), size_(buffer.available()) {}
+
+  /**
+   * @brief Checks if every header has been read.
+   * @return True at the end of the buffer.
+   */
+  bool at_end() const {
+    return buffer_.is_eof();
+  }
+
+  /**
+   * @brief Gets the offset of the next header.
+   * @return The number of bytes read so far.
+   */
+  size_t position() const {
+    return size_ - buffer_.available();
+  }
+
+  /**
+   * @brief Reads the next header and skips its packed data.
+   *
+   * The packed data is set in `out.packed`. Merged entries other than the last of their group
+   * carry none.
+   *
+   * @param out The view.
+   * @return Status indicating success or the specific error encountered.
+   */
+  Status next(HeaderView& out);
+
+ private:
+  InputBuffer buffer_;
+  size_t      size_;
+};
+
+
 class Entry {
  private:
-  struct {
-    ProtectionBits                       attributes_;        // File protection modes
-    uint8_t                              reserved1_;         // Reserved
-    Value<uint32_t, std::endian::little> unpack_size_;       // Unpacked size
-    Value<uint32_t, std::endian::little> pack_size_;         // Packed size
-    uint8_t                              machine_type_;      // Machine type
-    CompressionInfo                      compression_info_;  // Compression info
-    Flags                                flags_;             // Flags
-    uint8_t                              reserved2_;         // Reserved
-    uint8_t                              comment_length_;    // Comment length
-    uint8_t                              extract_ver_;       // Version needed to extract
-    uint8_t                              reserved3_[2];      // Reserved
-    DateStamp                            date_;              // Packed date
-    Value<uint32_t, std::endian::little> data_crc_;          // Data CRC
-    Value<uint32_t, std::endian::little> header_crc_;        // Header CRC
-    uint8_t                              filename_length_;   // Filename length
-  } PACKED metadata_;
-
-  static_assert(sizeof(metadata_) == 31);
+  Header metadata_;
 
   std::string filename_;
   std::string comment_;
 
  public:
+  /**
+   * @brief Gets the fixed part of the header.
+   * @return The Header.
+   */
+  constexpr const Header& header() const {
+    return metadata_;
+  }
+
   /**
    * @brief Gets the unpack size of the entry.
    * @return The unpacked size in bytes.
    */
   constexpr size_t unpack_size() const {
-    return metadata_.unpack_size_.value();
+    return metadata_.unpack_size();
   }
 
   /**
@@ -183,7 +351,7 @@ class Entry {
    * @return The packed size in bytes.
    */
   constexpr size_t pack_size() const {
-    return metadata_.pack_size_.value();
+    return metadata_.pack_size();
   }
 
   /**
@@ -191,7 +359,7 @@ class Entry {
    * @return The DateStamp object.
    */
   constexpr const DateStamp& datestamp() const {
-    return metadata_.date_;
+    return metadata_.datestamp();
   }
 
   /**
@@ -199,7 +367,7 @@ class Entry {
    * @return The CRC-32 value.
    */
   constexpr uint32_t data_crc() const {
-    return metadata_.data_crc_.value();
+    return metadata_.data_crc();
   }
 
   /**
@@ -207,7 +375,7 @@ class Entry {
    * @return The CompressionInfo object.
    */
   constexpr CompressionInfo compression_info() const {
-    return metadata_.compression_info_;
+    return metadata_.compression_info();
   }
 
   /**
@@ -215,7 +383,7 @@ class Entry {
    * @return The ProtectionBits object.
    */
   constexpr ProtectionBits attributes() const {
-    return metadata_.attributes_;
+    return metadata_.attributes();
   }
 
   /**
@@ -223,7 +391,7 @@ class Entry {
    * @return The Flags object.
    */
   constexpr Flags flags() const {
-    return metadata_.flags_;
+    return metadata_.flags();
   }
 
   /**
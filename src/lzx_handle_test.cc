@@ -0,0 +1,64 @@
+#include "lzx_handle.hh"
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "test_archive.hh"
+
+namespace {
+
+// The archive contents following the 10-byte archive header.
+InputBuffer headers_of(const std::vector<uint8_t>& bytes) {
+  return InputBuffer(bytes.data() + 10, bytes.size() - 10);
+}
+
+TEST(HeaderIteratorTest, ReadsHeadersInPlace) {
+  TestArchive archive;
+  archive.add_block({{"single", std::vector<uint8_t>(40, 1)}});
+  archive.add_block({{"merged_a", std::vector<uint8_t>(10, 2)}, {"merged_b", std::vector<uint8_t>(20, 3)}});
+  const auto& bytes = archive.bytes();
+
+  lzx::HeaderIterator headers(headers_of(bytes));
+  lzx::HeaderView     view;
+
+  ASSERT_EQ(headers.position(), 0U);
+  ASSERT_EQ(headers.next(view), Status::Ok);
+  EXPECT_EQ(view.filename, "single");
+  EXPECT_TRUE(view.comment.empty());
+  EXPECT_EQ(view.header->unpack_size(), 40U);
+  EXPECT_EQ(view.packed.size(), 40U);
+  EXPECT_GE(view.filename.data(), reinterpret_cast<const char*>(bytes.data()));
+  EXPECT_LT(view.filename.data(), reinterpret_cast<const char*>(bytes.data() + bytes.size()));
+
+  ASSERT_EQ(headers.next(view), Status::Ok);
+  EXPECT_EQ(view.filename, "merged_a");
+  EXPECT_TRUE(view.header->flags().is_merged());
+  EXPECT_TRUE(view.packed.empty());
+
+  ASSERT_EQ(headers.next(view), Status::Ok);
+  EXPECT_EQ(view.filename, "merged_b");
+  EXPECT_EQ(view.packed.size(), 30U);
+  EXPECT_EQ(view.packed.data() + view.packed.size(), bytes.data() + bytes.size());
+  EXPECT_TRUE(headers.at_end());
+}
+
+TEST(HeaderIteratorTest, ChecksHeaderCrc) {
+  TestArchive archive;
+  archive.add_block({{"file", std::vector<uint8_t>(5, 1)}});
+  auto bytes = archive.bytes();
+  bytes[10 + 31] ^= 0x20;  // First character of the filename.
+
+  lzx::HeaderIterator headers(headers_of(bytes));
+  lzx::HeaderView     view;
+  EXPECT_EQ(headers.next(view), Status::ChecksumInvalid);
+
+  bytes[10 + 31] ^= 0x20;
+  InputBuffer                 buffer = headers_of(bytes);
+  std::unique_ptr<lzx::Entry> entry;
+  ASSERT_EQ(lzx::Entry::from_buffer(&buffer, entry), Status::Ok);
+  EXPECT_EQ(entry->filename(), "file");
+  EXPECT_EQ(entry->header().header_crc(), entry->header().compute_crc("file", ""));
+}
+
+}  // namespace
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace huffman {
+
+/// Most bytes `copy_match()` may write past the end of the match.
+inline constexpr size_t kMatchCopyOverrun = 32;
+
+/**
+ * @brief Copies an LZ77 match, the same as `out[i] = out[i - offset]` for every `i < count`.
+ *
+ * Copies 32, 16 or 8 bytes per step, as far as the offset allows. Offsets below 8 repeat the
+ * pattern of the last `offset` bytes instead, and offset 1 is a fill. The bytes from `out + count`
+ * to `out + count + kMatchCopyOverrun` may be overwritten with garbage.
+ *
+ * @param out Where the match goes; at least `offset` bytes must precede it.
+ * @param offset Distance back to the match source, at least 1.
+ * @param count Match length.
+ */
+inline void copy_match(uint8_t* out, size_t offset, size_t count) {
+  const uint8_t* src = out - offset;
+  uint8_t*       end = out + count;
+
+  if (offset >= 32) {
+    // Every chunk reads bytes that are final before it is written.
+    do {
+      std::memcpy(out, src, 32);
+      out += 32;
+      src += 32;
+    } while (out < end);
+  } else if (offset >= 16) {
+    do {
+      std::memcpy(out, src, 16);
+      out += 16;
+      src += 16;
+    } while (out < end);
+  } else if (offset >= 8) {
+    do {
+      std::memcpy(out, src, 8);
+      out += 8;
+      src += 8;
+    } while (out < end);
+  } else if (offset == 1) {
+    std::memset(out, *src, count);
+  } else {
+    // Repeat the pattern across 8 bytes, then advance by whole periods only.
+    constexpr std::array<uint8_t, 8> kStep = {0, 0, 8, 6, 8, 5, 6, 7};
+
+    uint8_t pattern[8];
+    for (size_t i = 0; i < sizeof(pattern); i++) {
+      pattern[i] = src[i % offset];
+    }
+    const size_t step = kStep[offset];
+    do {
+      std::memcpy(out, pattern, sizeof(pattern));
+      out += step;
+    } while (out < end);
+  }
+}
+
+}  // namespace huffman
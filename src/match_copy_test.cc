@@ -0,0 +1,47 @@
+#include "match_copy.hh"
+
+#include <gtest/gtest.h>
+
+#include <random>
+#include <vector>
+
+namespace {
+
+using huffman::copy_match;
+using huffman::kMatchCopyOverrun;
+
+TEST(MatchCopyTest, MatchesByteLoop) {
+  std::mt19937 rng(11);
+
+  for (size_t offset = 1; offset <= 80; ++offset) {
+    for (size_t count = 3; count <= 258; count += (count < 40 ? 1 : 17)) {
+      std::vector<uint8_t> history(offset);
+      for (auto& byte : history) byte = static_cast<uint8_t>(rng());
+
+      std::vector<uint8_t> expected = history;
+      expected.resize(offset + count);
+      for (size_t i = offset; i < offset + count; ++i) expected[i] = expected[i - offset];
+
+      std::vector<uint8_t> actual = history;
+      actual.resize(offset + count + kMatchCopyOverrun);
+      copy_match(actual.data() + offset, offset, count);
+      actual.resize(offset + count);
+
+      ASSERT_EQ(actual, expected) << "offset " << offset << ", count " << count;
+    }
+  }
+}
+
+TEST(MatchCopyTest, StaysWithinOverrun) {
+  for (size_t offset : {1, 2, 3, 7, 8, 15, 16, 31, 32, 100}) {
+    for (size_t count = 1; count <= 70; ++count) {
+      std::vector<uint8_t> buffer(offset + count + kMatchCopyOverrun + 16, 0xAA);
+      copy_match(buffer.data() + offset, offset, count);
+      for (size_t i = offset + count + kMatchCopyOverrun; i < buffer.size(); ++i) {
+        ASSERT_EQ(buffer[i], 0xAA) << "offset " << offset << ", count " << count;
+      }
+    }
+  }
+}
+
+}  // namespace
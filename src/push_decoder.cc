@@ -0,0 +1,98 @@
+#include "push_decoder.hh"
+
+#include <algorithm>
+#include <cstring>
+
+#include "block_decoder.hh"
+#include "match_copy.hh"
+
+namespace huffman {
+
+PushDecoder::PushDecoder(size_t unpacked_size)
+    : unpacked_size_{unpacked_size}, buffer_(BlockDecoder::kStreamBufferSize) {}
+
+// The bits read ahead of the decoder are handed from one call to the next through a BitReader
+// over the new input. A step the input cannot complete is dropped, so the reader is then short of
+// a full refill, and refilling it takes in every whole word of the input.
+Status PushDecoder::decode(
+    std::span<const uint8_t>& input, std::span<uint8_t>& output, Progress& progress) {
+  if (has_odd_byte_ && !input.empty()) {
+    bits_ |= uint64_t{static_cast<uint16_t>((odd_byte_ << 8) | input[0])} << bit_count_;
+    bit_count_ += 16;
+    has_odd_byte_ = false;
+    input         = input.subspan(1);
+  }
+
+  BitReader reader(input, bits_, bit_count_);
+  Status    status = run(reader, output, progress);
+  if (progress == Progress::NeedInput) reader.refill();
+
+  bits_      = reader.buffered_bits();
+  bit_count_ = reader.buffered_count();
+  input      = input.subspan(reader.position());
+  if (progress == Progress::NeedInput && input.size() == 1) {
+    odd_byte_     = input[0];
+    has_odd_byte_ = true;
+    input         = input.subspan(1);
+  }
+  return status;
+}
+
+Status PushDecoder::run(BitReader& reader, std::span<uint8_t>& output, Progress& progress) {
+  constexpr size_t kLimit =
+      BlockDecoder::kStreamBufferSize - HuffmanDecoder::kMaxMatchLength - kMatchCopyOverrun;
+  constexpr size_t kWindowSize = BlockDecoder::kWindowSize;
+
+  while (true) {
+    // Write out what has been decoded; the last match may run past the end of the block.
+    size_t ready = std::min(pos_, unpacked_size_ - base_);
+    size_t count = std::min(ready - emitted_, output.size());
+    std::memcpy(output.data(), buffer_.data() + emitted_, count);
+    emitted_ += count;
+    output = output.subspan(count);
+
+    if (produced() == unpacked_size_) {
+      progress = Progress::Done;
+      return Status::Ok;
+    }
+    if (emitted_ < ready) {
+      progress = Progress::OutputFull;
+      return Status::Ok;
+    }
+
+    if (pos_ >= kLimit) {
+      std::memmove(buffer_.data(), buffer_.data() + pos_ - kWindowSize, kWindowSize);
+      base_ += pos_ - kWindowSize;
+      pos_     = kWindowSize;
+      emitted_ = kWindowSize;
+    }
+
+    if (decrunch_length_ == 0) {
+      bool complete = false;
+      TRY(decoder_.read_literal_table(&reader, complete));
+      if (!complete) {
+        progress = Progress::NeedInput;
+        return Status::Ok;
+      }
+      decrunch_length_ = decoder_.decrunch_length();
+      continue;
+    }
+
+    size_t target_size = std::min({pos_ + decrunch_length_, kLimit, unpacked_size_ - base_});
+    size_t old_pos     = pos_;
+    TRY(decoder_.decrunch_available(&reader, buffer_, pos_, target_size));
+
+    size_t decoded_bytes = pos_ - old_pos;
+    if (decoded_bytes == 0) {
+      progress = Progress::NeedInput;
+      return Status::Ok;
+    }
+    if (decoded_bytes > decrunch_length_) {
+      decrunch_length_ = 0;
+    } else {
+      decrunch_length_ -= decoded_bytes;
+    }
+  }
+}
+
+}  // namespace huffman
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "bit_reader.hh"
+#include "error.hh"
+#include "huffman_decoder.hh"
+#include "huffman_table.hh"
+
+namespace huffman {
+
+/**
+ * @brief Decompresses one packed LZX block from input that arrives in pieces.
+ *
+ * Unlike BlockDecoder, which needs the whole packed block in memory, the caller pushes the packed
+ * data in chunks of any size, and pulls the output into buffers of any size. When either runs out,
+ * `decode()` returns and later resumes where it stopped, even in the middle of a symbol or of the
+ * tables of a sub-block. Memory use does not depend on the size of the block.
+ */
+class PushDecoder {
+ public:
+  /// Why `decode()` returned.
+  enum class Progress : uint8_t {
+    NeedInput,   ///< Every input byte was used; call again with the data that follows.
+    OutputFull,  ///< The output is full; call again with more room.
+    Done,        ///< The whole block has been written out.
+  };
+
+  /**
+   * @brief Constructs a new PushDecoder.
+   * @param unpacked_size The total size of the decompressed data.
+   */
+  explicit PushDecoder(size_t unpacked_size);
+
+  /**
+   * @brief Decompresses as much as the input and the output allow.
+   *
+   * Running out of input is not an error: if the packed data has ended when Progress::NeedInput
+   * is returned, the block is truncated.
+   *
+   * @param input The packed data following the data of the previous call; advanced past the
+   *              bytes used. Bytes left over on Progress::OutputFull must be passed again.
+   * @param output Where to write decompressed data; advanced past the bytes written.
+   * @param progress Why decompression stopped.
+   * @return Status indicating success or the specific error encountered.
+   */
+  Status decode(std::span<const uint8_t>& input, std::span<uint8_t>& output, Progress& progress);
+
+  /**
+   * @brief Gets the number of decompressed bytes written out so far.
+   * @return The number of bytes.
+   */
+  size_t produced() const {
+    return base_ + emitted_;
+  }
+
+  /**
+   * @brief Gets the decode table cache counters.
+   * @return The number of Huffman tables reused and built so far.
+   */
+  HuffmanTableCache::Stats table_cache_stats() const {
+    return decoder_.table_cache_stats();
+  }
+
+ private:
+  // Decodes from `reader` and writes out decoded data until the input or the output runs out.
+  Status run(BitReader& reader, std::span<uint8_t>& output, Progress& progress);
+
+  HuffmanDecoder decoder_;
+  size_t         unpacked_size_;
+  // Bytes left in the current sub-block.
+  size_t decrunch_length_{};
+
+  // Input bits read ahead of the decoder, and a byte waiting for the other half of its word.
+  uint64_t bits_{};
+  size_t   bit_count_{};
+  uint8_t  odd_byte_{};
+  bool     has_odd_byte_{};
+
+  // The last `BlockDecoder::kWindowSize` bytes of output followed by newly decoded data, as in
+  // `BlockDecoder::stream()`. `base_` is the output offset of its start; data before `emitted_`
+  // has been written out.
+  std::vector<uint8_t> buffer_;
+  size_t               base_{};
+  size_t               pos_{};
+  size_t               emitted_{};
+};
+
+}  // namespace huffman
@@ -0,0 +1,127 @@
+#include "push_decoder.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "test_encoder.hh"
+
+namespace {
+
+using huffman::PushDecoder;
+using test_encoder::encode_random;
+
+TEST(PushDecoderTest, DecodesWholeBlockInOneCall) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(300000, 40000, expected, 1);
+
+  std::vector<uint8_t>     output(expected.size());
+  std::span<const uint8_t> input(packed);
+  std::span<uint8_t>       room(output);
+  PushDecoder              decoder(expected.size());
+  PushDecoder::Progress    progress;
+  ASSERT_EQ(decoder.decode(input, room, progress), Status::Ok);
+  EXPECT_EQ(progress, PushDecoder::Progress::Done);
+  EXPECT_TRUE(room.empty());
+  EXPECT_EQ(output, expected);
+}
+
+TEST(PushDecoderTest, ResumesOnEveryByteOfInput) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(60000, 7000, expected, 2);
+
+  std::vector<uint8_t>  output(expected.size());
+  std::span<uint8_t>    room(output);
+  PushDecoder           decoder(expected.size());
+  PushDecoder::Progress progress = PushDecoder::Progress::NeedInput;
+
+  // One byte at a time suspends inside the tables of every sub-block and inside symbols.
+  size_t fed = 0;
+  while (progress == PushDecoder::Progress::NeedInput) {
+    ASSERT_LT(fed, packed.size());
+    std::span<const uint8_t> input(packed.data() + fed++, 1);
+    ASSERT_EQ(decoder.decode(input, room, progress), Status::Ok);
+    EXPECT_TRUE(input.empty());
+  }
+  EXPECT_EQ(progress, PushDecoder::Progress::Done);
+  EXPECT_EQ(output, expected);
+}
+
+TEST(PushDecoderTest, ResumesOnEveryByteWithChangingCodes) {
+  std::vector<uint8_t>  expected;
+  test_encoder::Summary summary;
+  std::vector<uint8_t>  packed = encode_random(80000, 4000, expected, 5, {.random_codes = true},
+      &summary);
+  ASSERT_GT(summary.methods[1], 0U);
+  ASSERT_GT(summary.methods[3], 0U);
+
+  // Suspends inside the aligned offset lengths and the runs of literal bit lengths too.
+  std::vector<uint8_t>  output(expected.size());
+  std::span<uint8_t>    room(output);
+  PushDecoder           decoder(expected.size());
+  PushDecoder::Progress progress = PushDecoder::Progress::NeedInput;
+  size_t                fed      = 0;
+  while (progress == PushDecoder::Progress::NeedInput) {
+    ASSERT_LT(fed, packed.size());
+    std::span<const uint8_t> input(packed.data() + fed++, 1);
+    ASSERT_EQ(decoder.decode(input, room, progress), Status::Ok);
+  }
+  EXPECT_EQ(progress, PushDecoder::Progress::Done);
+  EXPECT_EQ(output, expected);
+}
+
+TEST(PushDecoderTest, ResumesWithRandomInputAndOutputSizes) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(700000, 50000, expected, 3);
+
+  std::mt19937             rng(3);
+  std::vector<uint8_t>     output;
+  std::vector<uint8_t>     room_buffer(5000);
+  std::span<const uint8_t> input;
+  size_t                   fed = 0;
+  PushDecoder              decoder(expected.size());
+  PushDecoder::Progress    progress = PushDecoder::Progress::NeedInput;
+  while (progress != PushDecoder::Progress::Done) {
+    if (progress == PushDecoder::Progress::NeedInput) {
+      ASSERT_TRUE(input.empty());
+      ASSERT_LT(fed, packed.size());
+      size_t size = std::min<size_t>(1 + rng() % 3000, packed.size() - fed);
+      input       = std::span<const uint8_t>(packed.data() + fed, size);
+      fed += size;
+    }
+
+    std::span<uint8_t> room(room_buffer.data(), 1 + rng() % room_buffer.size());
+    size_t             size = room.size();
+    ASSERT_EQ(decoder.decode(input, room, progress), Status::Ok);
+    output.insert(output.end(), room_buffer.begin(), room_buffer.begin() + (size - room.size()));
+    EXPECT_EQ(decoder.produced(), output.size());
+  }
+  EXPECT_EQ(output, expected);
+}
+
+TEST(PushDecoderTest, AsksForMoreInputWhenTruncated) {
+  std::vector<uint8_t> expected;
+  std::vector<uint8_t> packed = encode_random(50000, 10000, expected, 4);
+
+  std::vector<uint8_t>     output(expected.size());
+  std::span<const uint8_t> input(packed.data(), packed.size() / 2);
+  std::span<uint8_t>       room(output);
+  PushDecoder              decoder(expected.size());
+  PushDecoder::Progress    progress;
+  ASSERT_EQ(decoder.decode(input, room, progress), Status::Ok);
+  EXPECT_EQ(progress, PushDecoder::Progress::NeedInput);
+  EXPECT_TRUE(input.empty());
+  EXPECT_GT(decoder.produced(), 0U);
+  EXPECT_LT(decoder.produced(), expected.size());
+  EXPECT_TRUE(std::equal(output.begin(), output.begin() + decoder.produced(), expected.begin()));
+
+  input = std::span<const uint8_t>(packed.data() + packed.size() / 2, packed.size() - packed.size() / 2);
+  ASSERT_EQ(decoder.decode(input, room, progress), Status::Ok);
+  EXPECT_EQ(progress, PushDecoder::Progress::Done);
+  EXPECT_EQ(output, expected);
+}
+
+}  // namespace
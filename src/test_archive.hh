@@ -0,0 +1,147 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "crc.hh"
+#include "unlzx.hh"
+
+/**
+ * @brief Builds LZX archives for tests.
+ */
+class TestArchive {
+ public:
+  struct File {
+    std::string          name;
+    std::vector<uint8_t> data;
+  };
+
+  /**
+   * @brief Adds a block holding the given files; more than one file makes a merged group.
+   * @param files The files, in order.
+   * @param packed The packed data of the block, or empty to store the files uncompressed.
+   */
+  void add_block(const std::vector<File>& files, const std::vector<uint8_t>& packed = {}) {
+    bool   merged    = files.size() > 1;
+    size_t pack_size = packed.size();
+    if (packed.empty()) {
+      for (const auto& file : files) pack_size += file.data.size();
+    }
+
+    for (size_t index = 0; index < files.size(); ++index) {
+      bool last = index + 1 == files.size();
+      add_header(files[index], last ? pack_size : 0, merged, !packed.empty());
+    }
+    if (!packed.empty()) {
+      bytes_.insert(bytes_.end(), packed.begin(), packed.end());
+      return;
+    }
+    for (const auto& file : files) {
+      bytes_.insert(bytes_.end(), file.data.begin(), file.data.end());
+    }
+  }
+
+  /**
+   * @brief Gets the archive contents.
+   * @return The archive header followed by every block added so far.
+   */
+  const std::vector<uint8_t>& bytes() const {
+    return bytes_;
+  }
+
+ private:
+  static void put32(std::vector<uint8_t>& out, uint32_t value) {
+    for (size_t shift = 0; shift < 32; shift += 8) out.push_back(static_cast<uint8_t>(value >> shift));
+  }
+
+  void add_header(const File& file, size_t pack_size, bool merged, bool compressed) {
+    crc::Crc32 data_crc;
+    data_crc.calc(file.data.data(), file.data.size());
+
+    std::vector<uint8_t> header;
+    header.push_back(0x0F);  // Attributes: rwed.
+    header.push_back(0);
+    put32(header, static_cast<uint32_t>(file.data.size()));
+    put32(header, static_cast<uint32_t>(pack_size));
+    header.push_back(10);  // Machine type: Amiga.
+    header.push_back(compressed ? 2 : 0);  // Compression: normal or stored.
+    header.push_back(merged ? 1 : 0);
+    header.push_back(0);
+    header.push_back(0);   // Comment length.
+    header.push_back(10);  // Version needed to extract.
+    header.push_back(0);
+    header.push_back(0);
+    put32(header, 0);  // Datestamp.
+    put32(header, data_crc.sum());
+    put32(header, 0);  // Header CRC, filled in below.
+    header.push_back(static_cast<uint8_t>(file.name.size()));
+    header.insert(header.end(), file.name.begin(), file.name.end());
+
+    crc::Crc32 header_crc;
+    header_crc.calc(header.data(), header.size());
+    uint32_t sum = header_crc.sum();
+    for (size_t index = 0; index < 4; ++index) header[26 + index] = static_cast<uint8_t>(sum >> (8 * index));
+
+    bytes_.insert(bytes_.end(), header.begin(), header.end());
+  }
+
+  std::vector<uint8_t> bytes_ = {'L', 'Z', 'X', 0, 0, 0, 0, 0, 0, 0};
+};
+
+/**
+ * @brief Fixture running each test in an empty working directory, with helpers to open archives.
+ */
+class ArchiveTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    const auto* test = ::testing::UnitTest::GetInstance()->current_test_info();
+    original_        = std::filesystem::current_path();
+    root_            = std::filesystem::temp_directory_path() /
+            (std::string(test->test_suite_name()) + "." + test->name());
+    std::filesystem::remove_all(root_);
+    std::filesystem::create_directories(root_ / "out");
+    std::filesystem::current_path(root_ / "out");
+  }
+
+  void TearDown() override {
+    std::filesystem::current_path(original_);
+    std::filesystem::remove_all(root_);
+  }
+
+  /// Writes the archive next to the working directory and lists it.
+  std::map<std::string, LzxEntry> open(const std::vector<uint8_t>& bytes) {
+    auto path = root_ / "test.lzx";
+    {
+      std::ofstream file(path, std::ios::binary);
+      file.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+    EXPECT_EQ(unlzx_.open_archive(path.string().c_str()), Status::Ok);
+    return unlzx_.list_archive();
+  }
+
+  std::map<std::string, LzxEntry> open(const TestArchive& archive) {
+    return open(archive.bytes());
+  }
+
+  static std::vector<uint8_t> pattern(size_t size, uint8_t seed) {
+    std::vector<uint8_t> data(size);
+    for (size_t index = 0; index < size; ++index) data[index] = static_cast<uint8_t>(index * 7 + seed);
+    return data;
+  }
+
+  static std::vector<uint8_t> read_file(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), {});
+  }
+
+  std::filesystem::path original_;
+  std::filesystem::path root_;
+  Unlzx                 unlzx_;
+};
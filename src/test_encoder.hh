@@ -0,0 +1,341 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <random>
+#include <span>
+#include <utility>
+#include <vector>
+
+/// Minimal LZX encoder, to produce packed blocks for tests.
+namespace test_encoder {
+
+inline constexpr uint8_t kExtraBits[32] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9,
+    9, 10, 10, 11, 11, 12, 12, 13, 13, 14, 14};
+
+inline constexpr uint32_t kBaseOffsets[32] = {0, 1, 2, 3, 4, 6, 8, 12, 16, 24, 32, 48, 64, 96, 128, 192,
+    256, 384, 512, 768, 1024, 1536, 2048, 3072, 4096, 6144, 8192, 12288, 16384, 24576, 32768,
+    49152};
+
+/// Writes an LZX bit stream: big-endian 16-bit words, filled LSB first.
+class BitWriter {
+ public:
+  void bits(uint32_t value, size_t count) {
+    for (size_t i = 0; i < count; ++i) put((value >> i) & 1);
+  }
+
+  void code(uint32_t code, size_t length) {
+    while (length-- > 0) put((code >> length) & 1);
+  }
+
+  std::vector<uint8_t> finish() {
+    while (count_ != 0) put(0);
+    return std::move(data_);
+  }
+
+ private:
+  void put(uint32_t bit) {
+    word_ |= bit << count_;
+    if (++count_ == 16) {
+      data_.push_back(static_cast<uint8_t>(word_ >> 8));
+      data_.push_back(static_cast<uint8_t>(word_));
+      word_  = 0;
+      count_ = 0;
+    }
+  }
+
+  std::vector<uint8_t> data_;
+  uint32_t             word_{};
+  size_t               count_{};
+};
+
+inline size_t slot_for(uint32_t value, size_t slots) {
+  size_t slot = 0;
+  while (slot + 1 < slots && kBaseOffsets[slot + 1] <= value) ++slot;
+  return slot;
+}
+
+/// A prefix code, with the canonical code of each symbol.
+struct Code {
+  std::vector<uint8_t>  lengths;
+  std::vector<uint32_t> codes;
+
+  void put(BitWriter& writer, uint32_t symbol) const {
+    writer.code(codes[symbol], lengths[symbol]);
+  }
+};
+
+/// Assigns canonical codes to the given bit lengths: shorter codes first, then in symbol order.
+inline Code make_code(std::vector<uint8_t> lengths) {
+  Code     code{std::move(lengths), {}};
+  uint32_t next = 0;  // Left-aligned to 16 bits.
+  code.codes.resize(code.lengths.size());
+  for (uint32_t length = 1; length <= 16; ++length) {
+    for (size_t symbol = 0; symbol < code.lengths.size(); ++symbol) {
+      if (code.lengths[symbol] != length) continue;
+      code.codes[symbol] = next >> (16 - length);
+      next += 1U << (16 - length);
+    }
+  }
+  return code;
+}
+
+/**
+ * Computes Huffman code lengths for the given symbol weights. Symbols of weight zero get no code,
+ * and weights are flattened until no code is longer than `max_length`.
+ */
+inline std::vector<uint8_t> code_lengths(std::vector<uint64_t> weights, size_t max_length) {
+  // A complete code has at least two symbols.
+  for (size_t symbol = 0; std::count(weights.begin(), weights.end(), 0) + 2 >
+                          static_cast<std::ptrdiff_t>(weights.size());
+       ++symbol) {
+    if (weights[symbol] == 0) weights[symbol] = 1;
+  }
+
+  std::vector<uint8_t> lengths(weights.size());
+  while (true) {
+    using Node = std::pair<uint64_t, size_t>;
+    std::priority_queue<Node, std::vector<Node>, std::greater<>> queue;
+    std::vector<size_t> parent(weights.size());
+    for (size_t symbol = 0; symbol < weights.size(); ++symbol) {
+      if (weights[symbol] != 0) queue.push({weights[symbol], symbol});
+    }
+    while (queue.size() > 1) {
+      auto [first_weight, first]   = queue.top();
+      queue.pop();
+      auto [second_weight, second] = queue.top();
+      queue.pop();
+      parent[first] = parent[second] = parent.size();
+      parent.push_back(0);
+      queue.push({first_weight + second_weight, parent.size() - 1});
+    }
+
+    // Inner nodes come after their children, and the root last.
+    std::vector<size_t> depth(parent.size());
+    for (size_t node = parent.size() - 1; node-- > 0;) depth[node] = depth[parent[node]] + 1;
+
+    size_t longest = 0;
+    for (size_t symbol = 0; symbol < weights.size(); ++symbol) {
+      lengths[symbol] = static_cast<uint8_t>(weights[symbol] != 0 ? depth[symbol] : 0);
+      longest         = std::max<size_t>(longest, lengths[symbol]);
+    }
+    if (longest <= max_length) return lengths;
+    for (auto& weight : weights) {
+      if (weight != 0) weight = (weight >> 1) | 1;
+    }
+  }
+}
+
+/**
+ * Writes one of the two passes over the literal bit lengths: a pre-tree, then the lengths coded
+ * with it as deltas from `previous`, with runs of zeros and of equal lengths. `fix` is 1 for the
+ * first pass and 0 for the second.
+ */
+inline void write_bit_lengths(BitWriter& writer, std::span<const uint8_t> previous,
+    std::span<const uint8_t> lengths, uint32_t fix) {
+  struct Run {
+    uint32_t symbol;
+    uint32_t extra;
+    size_t   extra_bits;
+    uint32_t delta;  // Pre-tree symbol of the repeated length, after symbol 19.
+  };
+  auto delta = [&](size_t pos) { return (previous[pos] + 17U - lengths[pos]) % 17; };
+
+  std::vector<Run> runs;
+  for (size_t pos = 0; pos < lengths.size();) {
+    size_t run = 1;
+    while (pos + run < lengths.size() && lengths[pos + run] == lengths[pos]) ++run;
+
+    size_t count = 1;
+    if (lengths[pos] == 0 && run >= 19 + fix) {
+      count = std::min<size_t>(run, 18 + fix + (1U << (6 - fix)));
+      runs.push_back({18, static_cast<uint32_t>(count - 19 - fix), 6 - fix, 0});
+    } else if (lengths[pos] == 0 && run >= 3 + fix) {
+      count = std::min<size_t>(run, 18 + fix);
+      runs.push_back({17, static_cast<uint32_t>(count - 3 - fix), 4, 0});
+    } else if (run >= 3 + fix) {
+      count = std::min<size_t>(run, 4 + fix);
+      runs.push_back({19, static_cast<uint32_t>(count - 3 - fix), 1, delta(pos)});
+    } else {
+      runs.push_back({delta(pos), 0, 0, 0});
+    }
+    pos += count;
+  }
+
+  std::vector<uint64_t> weights(20);
+  for (const auto& run : runs) {
+    weights[run.symbol]++;
+    if (run.symbol == 19) weights[run.delta]++;
+  }
+  Code pre_tree = make_code(code_lengths(weights, 15));
+  for (auto length : pre_tree.lengths) writer.bits(length, 4);
+  for (const auto& run : runs) {
+    pre_tree.put(writer, run.symbol);
+    writer.bits(run.extra, run.extra_bits);
+    if (run.symbol == 19) pre_tree.put(writer, run.delta);
+  }
+}
+
+/// Sub-blocks for `encode_random()` to emit.
+struct Options {
+  /// Gives each sub-block a random method: 1 (verbatim, keeping the previous table), 2, or 3 (with
+  /// aligned offsets), and each new table random codes of up to 16 bits, some symbols going
+  /// without. Otherwise all sub-blocks are method 2, with the same 9-bit literal and 10-bit match
+  /// codes.
+  bool random_codes = false;
+  /// With `random_codes`, gives the literals below `literal_values` most of the code space, so
+  /// that when they are few their codes are short enough to decode in pairs.
+  bool short_literals = false;
+  /// Percentage of tokens that are literals.
+  uint32_t literal_percent = 25;
+  /// Literals are drawn from `[0, literal_values)`.
+  uint32_t literal_values = 256;
+};
+
+/// What `encode_random()` emitted.
+struct Summary {
+  size_t  methods[4]{};            ///< Number of sub-blocks of each method.
+  uint8_t longest_literal_code{};  ///< Length of the longest code emitted for a literal.
+};
+
+/**
+ * Encodes random literals and matches as sub-blocks of about `block_size` bytes, shaped by
+ * `options`. Fills `summary`, if given, with what was emitted.
+ */
+inline std::vector<uint8_t> encode_random(size_t size, size_t block_size,
+    std::vector<uint8_t>& expected, uint32_t seed, const Options& options = {},
+    Summary* summary = nullptr) {
+  constexpr size_t kNumSymbols = 768;
+
+  std::mt19937 rng(seed);
+  BitWriter    writer;
+  Summary      emitted;
+  Code         literal_code;
+  // The literal bit lengths as the decoder holds them, and the offset of the last match.
+  std::vector<uint8_t> previous(kNumSymbols);
+  uint32_t             last_offset = 1;
+
+  expected.clear();
+  while (expected.size() < size) {
+    // Method 1 keeps the literal table of the previous sub-block, and uses only the symbols it
+    // has a code for.
+    uint32_t method = 2;
+    if (options.random_codes) {
+      bool can_keep = !literal_code.lengths.empty() &&
+                      std::any_of(literal_code.lengths.begin(), literal_code.lengths.begin() + 256,
+                          [](uint8_t length) { return length != 0; });
+      method = can_keep ? 1 + rng() % 3 : 2 + rng() % 2;
+    }
+    emitted.methods[method]++;
+    auto has_code = [&](uint32_t symbol) {
+      return method != 1 || literal_code.lengths[symbol] != 0;
+    };
+
+    // Tokens first: the sub-block header holds its decoded length.
+    struct Token {
+      uint32_t symbol;
+      uint32_t offset;
+      uint32_t length;
+    };
+    std::vector<Token> tokens;
+    size_t             block_length = 0;
+    while (block_length < block_size && expected.size() < size) {
+      uint32_t length  = 3 + rng() % 256;
+      bool     literal = expected.empty() || rng() % 100 < options.literal_percent ||
+                     expected.size() + length > size;
+
+      // Offset slot 0 repeats the last offset.
+      uint32_t offset      = last_offset;
+      size_t   offset_slot = 0;
+      if (!literal && (!options.random_codes || rng() % 8 != 0)) {
+        uint32_t max_offset = static_cast<uint32_t>(std::min<size_t>(expected.size(), 65535));
+        offset      = rng() % 3 == 0 ? 1 + rng() % std::min<uint32_t>(max_offset, 8)
+                                     : 1 + rng() % max_offset;
+        offset_slot = slot_for(offset, 32);
+      }
+      auto symbol = static_cast<uint32_t>(256 + offset_slot + (slot_for(length - 3, 16) << 5));
+
+      if (literal || !has_code(symbol)) {
+        uint32_t value = rng() % options.literal_values;
+        while (!has_code(value)) value = (value + 1) % 256;
+        expected.push_back(static_cast<uint8_t>(value));
+        tokens.push_back({value, 0, 1});
+        block_length++;
+        continue;
+      }
+      for (uint32_t i = 0; i < length; ++i) {
+        expected.push_back(expected[expected.size() - offset]);
+      }
+      tokens.push_back({symbol, offset, length});
+      last_offset = offset;
+      block_length += length;
+    }
+
+    if (method != 1) {
+      std::vector<uint8_t> lengths(kNumSymbols, 9);
+      std::fill(lengths.begin() + 256, lengths.end(), 10);
+      if (options.random_codes) {
+        std::vector<bool> used(kNumSymbols);
+        for (const auto& token : tokens) used[token.symbol] = true;
+        // Symbols the sub-block does not use go without a code in random stretches.
+        std::vector<uint64_t> weights(kNumSymbols);
+        bool                  drop = false;
+        for (size_t symbol = 0; symbol < kNumSymbols; ++symbol) {
+          if (rng() % 32 == 0) drop = !drop;
+          if (used[symbol] || !drop) weights[symbol] = uint64_t{1} << (rng() % 16);
+          if (options.short_literals && symbol < options.literal_values) weights[symbol] <<= 16;
+        }
+        lengths = code_lengths(weights, 16);
+      }
+      literal_code = make_code(std::move(lengths));
+    }
+
+    Code aligned_code;
+    if (method == 3) {
+      std::vector<uint64_t> weights(8);
+      for (auto& weight : weights) weight = uint64_t{1} << (rng() % 8);
+      aligned_code = make_code(code_lengths(weights, 7));
+    }
+
+    writer.bits(method, 3);
+    for (auto length : aligned_code.lengths) writer.bits(length, 3);
+    writer.bits(static_cast<uint32_t>(block_length >> 16) & 0xFF, 8);
+    writer.bits(static_cast<uint32_t>(block_length >> 8) & 0xFF, 8);
+    writer.bits(static_cast<uint32_t>(block_length) & 0xFF, 8);
+
+    if (method != 1) {
+      std::span<const uint8_t> lengths(literal_code.lengths);
+      write_bit_lengths(writer, std::span(previous).first(256), lengths.first(256), 1);
+      write_bit_lengths(writer, std::span(previous).subspan(256), lengths.subspan(256), 0);
+      previous = literal_code.lengths;
+    }
+
+    for (const auto& token : tokens) {
+      literal_code.put(writer, token.symbol);
+      if (token.symbol < 256) {
+        emitted.longest_literal_code =
+            std::max(emitted.longest_literal_code, literal_code.lengths[token.symbol]);
+        continue;
+      }
+
+      size_t   offset_slot = (token.symbol - 256) & 31;
+      size_t   length_slot = (token.symbol - 256) >> 5;
+      uint32_t offset      = offset_slot == 0 ? 0 : token.offset - kBaseOffsets[offset_slot];
+      if (method == 3 && kExtraBits[offset_slot] >= 3) {
+        writer.bits(offset >> 3, kExtraBits[offset_slot] - 3);
+        aligned_code.put(writer, offset & 7);
+      } else {
+        writer.bits(offset, kExtraBits[offset_slot]);
+      }
+      writer.bits(token.length - 3 - kBaseOffsets[length_slot], kExtraBits[length_slot]);
+    }
+  }
+
+  if (summary != nullptr) *summary = emitted;
+  return writer.finish();
+}
+
+}  // namespace test_encoder
@@ -0,0 +1,116 @@
+#include "thread_pool.hh"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// The pool and worker index of the current thread, for tasks submitting tasks.
+thread_local const ThreadPool* current_pool  = nullptr;
+thread_local size_t            current_index = 0;
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (threads == 0) threads = std::max(1U, std::thread::hardware_concurrency());
+
+  for (size_t index = 0; index < threads; ++index) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (size_t index = 0; index < threads; ++index) {
+    threads_.emplace_back([this, index]() { run(index); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  wait();
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::submit(Task task) {
+  pending_.fetch_add(1, std::memory_order_relaxed);
+  bool from_worker = current_pool == this;
+
+  {
+    std::lock_guard lock(mutex_);
+    queued_.fetch_add(1, std::memory_order_relaxed);
+    if (!from_worker) injected_.push_back(std::move(task));
+  }
+
+  if (from_worker) {
+    Worker& worker = *workers_[current_index];
+    std::lock_guard lock(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+  wake_.notify_one();
+}
+
+void ThreadPool::wait() {
+  std::unique_lock lock(mutex_);
+  idle_.wait(lock, [this]() { return pending_.load(std::memory_order_acquire) == 0; });
+}
+
+bool ThreadPool::try_pop(size_t index, Task& task) {
+  {
+    Worker& own = *workers_[index];
+    std::lock_guard lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  {
+    std::lock_guard lock(mutex_);
+    if (!injected_.empty()) {
+      task = std::move(injected_.front());
+      injected_.pop_front();
+      return true;
+    }
+  }
+
+  for (size_t offset = 1; offset < workers_.size(); ++offset) {
+    Worker& victim = *workers_[(index + offset) % workers_.size()];
+    std::lock_guard lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::run(size_t index) {
+  current_pool  = this;
+  current_index = index;
+
+  while (true) {
+    Task task;
+    if (try_pop(index, task)) {
+      queued_.fetch_sub(1, std::memory_order_relaxed);
+      task();
+      task = nullptr;
+
+      if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        std::lock_guard lock(mutex_);
+        idle_.notify_all();
+      }
+      continue;
+    }
+
+    // `queued_` only grows under `mutex_`, so a task queued after the check still wakes us. It may
+    // be counted shortly before it can be popped; the loop then retries.
+    std::unique_lock lock(mutex_);
+    wake_.wait(lock, [this]() { return stopping_ || queued_.load(std::memory_order_relaxed) > 0; });
+    if (stopping_ && queued_.load(std::memory_order_relaxed) == 0) return;
+  }
+}
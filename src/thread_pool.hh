@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Work-stealing thread pool.
+ *
+ * Tasks submitted from outside the pool run in submission order. Tasks submitted by a running task
+ * go to the front of its own worker's queue, so follow-up work runs next, on the same core, while
+ * its data is still in cache. Idle workers steal the oldest task of a busy worker.
+ */
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  /**
+   * @brief Constructs a new ThreadPool and starts its workers.
+   * @param threads Number of worker threads; 0 for one per hardware thread.
+   */
+  explicit ThreadPool(size_t threads = 0);
+
+  /**
+   * @brief Waits for all tasks to complete, then stops the workers.
+   */
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&)            = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * @brief Queues a task.
+   * @param task The task to run on one of the workers.
+   */
+  void submit(Task task);
+
+  /**
+   * @brief Blocks until every submitted task, including tasks submitted by tasks, has completed.
+   *
+   * Must not be called from a task.
+   */
+  void wait();
+
+  /**
+   * @brief Gets the number of worker threads.
+   * @return The number of workers.
+   */
+  size_t size() const {
+    return threads_.size();
+  }
+
+ private:
+  struct Worker {
+    std::mutex       mutex;
+    std::deque<Task> tasks;
+  };
+
+  // Takes the next task for the given worker: its own newest, then the oldest external one, then
+  // another worker's oldest.
+  bool try_pop(size_t index, Task& task);
+  void run(size_t index);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread>             threads_;
+
+  // Guards `injected_`, sleeping and stopping.
+  std::mutex              mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::deque<Task>        injected_;
+  bool                    stopping_{};
+
+  // Tasks waiting in any queue, and tasks not yet completed.
+  std::atomic<size_t> queued_{};
+  std::atomic<size_t> pending_{};
+};
@@ -0,0 +1,67 @@
+#include "thread_pool.hh"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+namespace {
+
+TEST(ThreadPoolTest, RunsEveryTask) {
+  ThreadPool          pool(4);
+  std::atomic<size_t> count{};
+  for (size_t index = 0; index < 1000; ++index) {
+    pool.submit([&count]() { count.fetch_add(1); });
+  }
+  pool.wait();
+  EXPECT_EQ(count.load(), 1000U);
+}
+
+TEST(ThreadPoolTest, WaitsForTasksSubmittedByTasks) {
+  ThreadPool          pool(4);
+  std::atomic<size_t> count{};
+  for (size_t index = 0; index < 16; ++index) {
+    pool.submit([&pool, &count]() {
+      for (size_t inner = 0; inner < 16; ++inner) {
+        pool.submit([&count]() { count.fetch_add(1); });
+      }
+    });
+  }
+  pool.wait();
+  EXPECT_EQ(count.load(), 256U);
+}
+
+TEST(ThreadPoolTest, RunsExternalTasksInOrderOnOneThread) {
+  ThreadPool          pool(1);
+  std::vector<size_t> order;
+  for (size_t index = 0; index < 8; ++index) {
+    pool.submit([&order, index]() { order.push_back(index); });
+  }
+  pool.wait();
+  EXPECT_EQ(order, (std::vector<size_t>{0, 1, 2, 3, 4, 5, 6, 7}));
+}
+
+TEST(ThreadPoolTest, RunsFollowUpTaskNext) {
+  ThreadPool          pool(1);
+  std::vector<size_t> order;
+  pool.submit([&pool, &order]() {
+    order.push_back(0);
+    pool.submit([&order]() { order.push_back(1); });
+  });
+  pool.submit([&order]() { order.push_back(2); });
+  pool.wait();
+  EXPECT_EQ(order, (std::vector<size_t>{0, 1, 2}));
+}
+
+TEST(ThreadPoolTest, CanBeReusedAfterWait) {
+  ThreadPool          pool(2);
+  std::atomic<size_t> count{};
+  pool.submit([&count]() { count.fetch_add(1); });
+  pool.wait();
+  pool.submit([&count]() { count.fetch_add(1); });
+  pool.wait();
+  EXPECT_EQ(count.load(), 2U);
+  EXPECT_EQ(pool.size(), 2U);
+}
+
+}  // namespace
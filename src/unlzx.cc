@@ -29,9 +29,11 @@
 #include <print>
 #include <stdexcept>
 #include <string>
+#include <unordered_set>
 #include <utility>
 
 #include "crc.hh"
+#include "extractor.hh"
 #include "huffman_decoder.hh"
 #include "lzx_entry_builder.hh"
 #include "lzx_handle.hh"
@@ -43,6 +45,7 @@ std::map<std::string, LzxEntry> Unlzx::list_archive() {
 
   std::unique_ptr<lzx::Entry> archive_header;
   size_t current_decompressed_offset = 0;
+  size_t block_count = 0;
   struct PendingMerge {
     std::string filename;
     size_t      offset;
@@ -50,10 +53,14 @@ std::map<std::string, LzxEntry> Unlzx::list_archive() {
   };
   std::vector<PendingMerge> pending_merges;
 
+  list_status_ = Status::Ok;
   if (!in_buffer_) return {};
 
-  while (!in_buffer_->is_eof()) {
-    if (lzx::Entry::from_buffer(&*in_buffer_, archive_header) != Status::Ok) {
+  // Read through a copy, so that the archive can be listed or indexed again.
+  InputBuffer buffer = *in_buffer_;
+  while (!buffer.is_eof()) {
+    list_status_ = lzx::Entry::from_buffer(&buffer, archive_header);
+    if (list_status_ != Status::Ok) {
       break;
     }
 
@@ -69,11 +76,11 @@ std::map<std::string, LzxEntry> Unlzx::list_archive() {
       current_decompressed_offset += unpack_size;
 
       if (pack_size > 0) {
-        InputBuffer sub = *in_buffer_;
+        InputBuffer sub = buffer;
         InputBuffer block_data;
         sub.read_buffer(pack_size, block_data);
 
-        auto shared_block = std::make_shared<LzxBlock>(std::move(*archive_header), block_data, current_decompressed_offset);
+        auto shared_block = std::make_shared<LzxBlock>(std::move(*archive_header), block_data, current_decompressed_offset, block_count++, block_cache_);
         for (const auto& pending : pending_merges) {
           builders.at(pending.filename).add_segment(shared_block, pending.offset, pending.length);
         }
@@ -81,15 +88,16 @@ std::map<std::string, LzxEntry> Unlzx::list_archive() {
         current_decompressed_offset = 0;
       }
     } else {
-      InputBuffer sub = *in_buffer_;
+      InputBuffer sub = buffer;
       InputBuffer block_data;
       sub.read_buffer(pack_size, block_data);
 
-      auto shared_block = std::make_shared<LzxBlock>(std::move(*archive_header), block_data, unpack_size);
+      auto shared_block = std::make_shared<LzxBlock>(std::move(*archive_header), block_data, unpack_size, block_count++, block_cache_);
       builders.at(filename).add_segment(shared_block, 0, unpack_size);
     }
 
-    if (in_buffer_->skip(pack_size) != Status::Ok) {
+    list_status_ = buffer.skip(pack_size);
+    if (list_status_ != Status::Ok) {
       break;
     }
   }
@@ -102,8 +110,37 @@ std::map<std::string, LzxEntry> Unlzx::list_archive() {
   return entries;
 }
 
+Status Unlzx::index_archive(std::unique_ptr<ArchiveIndex>& out) const {
+  if (!in_buffer_) return Status::FileOpenError;
+  return ArchiveIndex::from_buffer(*in_buffer_, out, block_cache_);
+}
+
+Status Unlzx::index_archive(std::unique_ptr<ArchiveIndex>& out, const std::filesystem::path& sidecar) const {
+  if (!in_buffer_) return Status::FileOpenError;
+
+  ArchiveIndex::Stamp stamp;
+  TRY(ArchiveIndex::stamp_of(filename_, stamp));
+  if (ArchiveIndex::load(*in_buffer_, sidecar, stamp, out, block_cache_) == Status::Ok) {
+    return Status::Ok;
+  }
+
+  Status status = ArchiveIndex::from_buffer(*in_buffer_, out, block_cache_);
+  if (status == Status::Ok) out->save(sidecar, stamp);
+  return status;
+}
+
+void Unlzx::set_block_cache(std::optional<size_t> budget) {
+  block_cache_ = budget ? std::make_shared<BlockCache>(*budget) : nullptr;
+}
+
+std::optional<BlockCache::Stats> Unlzx::block_cache_stats() const {
+  if (!block_cache_) return std::nullopt;
+  return block_cache_->stats();
+}
+
 Status Unlzx::open_archive(const char* filename) {
   TRY(MmapInputBuffer::for_file(filename, mmap_buffer_));
+  filename_ = filename;
 
   in_buffer_ = mmap_buffer_->get();
 
@@ -117,3 +154,68 @@ Status Unlzx::open_archive(const char* filename) {
 
   return Status::Ok;
 }
+
+std::vector<std::filesystem::path> Unlzx::batch_destinations(
+    std::span<const std::filesystem::path> filenames) {
+  std::unordered_set<std::string> stems;
+  for (const auto& filename : filenames) stems.insert(filename.stem().string());
+
+  std::vector<std::filesystem::path> destinations;
+  std::unordered_set<std::string>    used;
+  for (const auto& filename : filenames) {
+    std::string stem        = filename.stem().string();
+    std::string destination = stem;
+    for (size_t suffix = 2;
+         used.contains(destination) || (destination != stem && stems.contains(destination));
+         ++suffix) {
+      destination = std::format("{}.{}", stem, suffix);
+    }
+    used.insert(destination);
+    destinations.emplace_back(std::move(destination));
+  }
+  return destinations;
+}
+
+std::vector<Unlzx::BatchArchive> Unlzx::open_archives(std::span<const std::filesystem::path> filenames,
+    ThreadPool& pool, std::span<const std::filesystem::path> destinations) {
+  std::vector<std::filesystem::path> own_destinations;
+  if (destinations.empty()) {
+    own_destinations = batch_destinations(filenames);
+    destinations     = own_destinations;
+  }
+  std::vector<BatchArchive> archives(filenames.size());
+
+  for (size_t index = 0; index < filenames.size(); ++index) {
+    pool.submit([&archive = archives[index], &filename = filenames[index],
+                    &destination = destinations[index]]() {
+      archive.filename    = filename;
+      archive.destination = destination;
+      archive.archive     = std::make_unique<Unlzx>();
+      archive.status      = archive.archive->open_archive(filename.string().c_str());
+      if (archive.status != Status::Ok) return;
+      archive.entries     = archive.archive->list_archive();
+      archive.list_status = archive.archive->list_status();
+    });
+  }
+  pool.wait();
+
+  return archives;
+}
+
+void Unlzx::extract_archives(std::span<BatchArchive> archives, ThreadPool& pool) {
+  std::vector<std::vector<const LzxEntry*>> selected(archives.size());
+  std::vector<Extractor::Job>               jobs;
+  for (size_t index = 0; index < archives.size(); ++index) {
+    if (archives[index].status == Status::Ok) {
+      for (const auto& [name, entry] : archives[index].entries) {
+        selected[index].push_back(&entry);
+      }
+    }
+    jobs.push_back({selected[index], archives[index].destination});
+  }
+
+  auto results = Extractor(pool).extract(jobs);
+  for (size_t index = 0; index < archives.size(); ++index) {
+    archives[index].results = std::move(results[index]);
+  }
+}
@@ -2,6 +2,7 @@
 
 #include <stdint.h>
 #include <deque>
+#include <filesystem>
 #include <map>
 #include <memory>
 #include <optional>
@@ -9,14 +10,65 @@
 #include <string>
 #include <vector>
 
+#include "archive_index.hh"
+#include "block_cache.hh"
 #include "error.hh"
 #include "mmap_buffer.hh"
 #include "lzx_handle.hh"
 #include "lzx_block.hh"
 #include "lzx_entry.hh"
+#include "thread_pool.hh"
 
 class Unlzx {
 public:
+  /**
+   * @brief One archive of a batch: its listing and, once extracted, the status of each entry.
+   */
+  struct BatchArchive {
+    std::filesystem::path           filename;                  ///< Path of the archive.
+    std::filesystem::path           destination;               ///< See `batch_destinations()`.
+    Status                          status      = Status::Ok;  ///< Status of opening the archive.
+    Status                          list_status = Status::Ok;  ///< See `list_status()`.
+    std::unique_ptr<Unlzx>          archive;                   ///< Keeps the archive mapped.
+    std::map<std::string, LzxEntry> entries;                   ///< The archive contents.
+    std::vector<Status>             results;                   ///< Status of each entry, once done.
+  };
+
+
+  /**
+   * @brief Picks the directory each archive of a batch extracts to.
+   *
+   * This is the archive name without its directory and extension. When an earlier archive of
+   * the batch already uses it, as `a/x.lzx` and `b/x.lzx` do, a numbered suffix (`x.2`) that no
+   * other archive uses is added instead.
+   *
+   * @param filenames The paths to the LZX archive files.
+   * @return The destination of each archive, in the same order; all different.
+   */
+  static std::vector<std::filesystem::path> batch_destinations(
+      std::span<const std::filesystem::path> filenames);
+
+  /**
+   * @brief Opens and lists several archives concurrently.
+   * @param filenames The paths to the LZX archive files.
+   * @param pool The pool to run on; must not be used concurrently by others.
+   * @param destinations Where to extract each archive; `batch_destinations(filenames)` if empty.
+   * @return The archives, in the same order.
+   */
+  static std::vector<BatchArchive> open_archives(std::span<const std::filesystem::path> filenames,
+      ThreadPool& pool, std::span<const std::filesystem::path> destinations = {});
+
+  /**
+   * @brief Extracts every entry of several archives, each under its own destination directory.
+   *
+   * The blocks of all archives are decoded together, so small archives keep every thread busy.
+   * Archives that failed to open are skipped.
+   *
+   * @param archives Archives from `open_archives()`; their results are filled in.
+   * @param pool The pool to run on; must not be used concurrently by others.
+   */
+  static void extract_archives(std::span<BatchArchive> archives, ThreadPool& pool);
+
   /**
    * @brief Opens an LZX archive from the given filename.
    * @param filename The path to the LZX archive file.
@@ -24,13 +76,62 @@ public:
    */
   Status open_archive(const char* filename);
 
+  /**
+   * @brief Keeps the decompressed blocks of the next `list_archive()` within a memory budget.
+   *
+   * Once the budget is exceeded, the least recently used blocks are freed and decompressed again
+   * when needed; see BlockCache. Without a budget, blocks keep their data until released.
+   *
+   * @param budget Maximum bytes of decompressed data to keep, or std::nullopt for no limit.
+   */
+  void set_block_cache(std::optional<size_t> budget);
+
+  /**
+   * @brief Gets the usage counters of the block cache.
+   * @return The counters, or std::nullopt if `set_block_cache()` set no budget.
+   */
+  std::optional<BlockCache::Stats> block_cache_stats() const;
+
   /**
    * @brief Lists the contents of the opened archive.
    * @return A map of filenames to their corresponding LzxEntry objects.
    */
   std::map<std::string, LzxEntry> list_archive();
 
+  /**
+   * @brief Builds a compact index of the opened archive, for archives with very many entries.
+   *
+   * The index reads headers in place from the mapping, so it must not outlive this object. Its
+   * blocks use the cache set by `set_block_cache()`.
+   *
+   * @param out The index, holding the entries read even if an error ended the listing early.
+   * @return Status::Ok if every header was read, otherwise the error, as for `list_status()`.
+   */
+  Status index_archive(std::unique_ptr<ArchiveIndex>& out) const;
+
+  /**
+   * @brief Loads the index of the opened archive from a sidecar file, or builds and saves it.
+   *
+   * A sidecar saved for another version of the archive is replaced. Only complete indices are
+   * saved; failing to save one is not an error, as it only costs the next open a header scan.
+   *
+   * @param out The index, as for `index_archive()`.
+   * @param sidecar The path to the sidecar file, e.g. the archive path followed by ".idx".
+   * @return Status::Ok if the index was loaded or every header was read, otherwise the error.
+   */
+  Status index_archive(std::unique_ptr<ArchiveIndex>& out, const std::filesystem::path& sidecar) const;
+
+  /**
+   * @brief Gets the status of the last `list_archive()`.
+   * @return Status::Ok if every header was read, otherwise the error that ended the listing early,
+   *         e.g. Status::ChecksumInvalid for a damaged header.
+   */
+  Status list_status() const { return list_status_; }
+
 private:
+  std::filesystem::path filename_;
   std::unique_ptr<MmapInputBuffer> mmap_buffer_;
   std::optional<InputBuffer> in_buffer_;
+  Status list_status_ = Status::Ok;
+  std::shared_ptr<BlockCache> block_cache_;
 };
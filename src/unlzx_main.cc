@@ -2,19 +2,63 @@
 #include <unistd.h>
 #endif
 
+#include <algorithm>
+#include <charconv>
+#include <chrono>
 #include <filesystem>
 #include <fstream>
+#include <iostream>
 #include <print>
 #include <regex>
 #include <set>
 #include <span>
+#include <unordered_map>
 #include <vector>
 
-#include "crc.hh"
+#include "catalog.hh"
 #include "error.hh"
+#include "extract_pipeline.hh"
+#include "extractor.hh"
+#include "thread_pool.hh"
 #include "unlzx.hh"
+#include "verifier.hh"
 
-enum class Action : uint8_t { List, Extract, View };
+enum class Action : uint8_t { List, Extract, View, Test };
+
+// Selects entries by exact name or, with --regex, by case-insensitive pattern; none selects all.
+class NameFilter {
+public:
+  NameFilter(std::span<char* const> names, bool use_regex) : names_(names), use_regex_(use_regex) {
+    if (use_regex) {
+      for (const char* pattern : names) {
+        res_.emplace_back(pattern, std::regex::ECMAScript | std::regex::icase);
+      }
+    }
+  }
+
+  bool matches(std::string_view name) const {
+    if (names_.empty()) {
+      return true;
+    }
+    for (size_t i = 0; i < names_.size(); ++i) {
+      if (use_regex_) {
+        if (std::regex_search(name.begin(), name.end(), res_[i])) {
+          return true;
+        }
+      } else {
+        if (name == names_[i]) {
+          return true;
+        }
+      }
+    }
+    return false;
+  }
+
+private:
+  std::span<char* const> names_;
+  bool use_regex_;
+  std::vector<std::regex> res_;
+};
 
 class FilteredEntries {
 public:
@@ -49,40 +93,16 @@ public:
   };
 
   FilteredEntries(const std::map<std::string, LzxEntry>& entries, std::span<char* const> names, bool use_regex)
-      : entries_(entries), names_(names), use_regex_(use_regex) {
-    if (use_regex) {
-      for (const char* pattern : names) {
-        res_.emplace_back(pattern, std::regex::ECMAScript | std::regex::icase);
-      }
-    }
-  }
+      : entries_(entries), filter_(names, use_regex) {}
 
-  bool matches(const std::string& name) const {
-    if (names_.empty()) {
-      return true;
-    }
-    for (size_t i = 0; i < names_.size(); ++i) {
-      if (use_regex_) {
-        if (std::regex_search(name, res_[i])) {
-          return true;
-        }
-      } else {
-        if (name == names_[i]) {
-          return true;
-        }
-      }
-    }
-    return false;
-  }
+  bool matches(const std::string& name) const { return filter_.matches(name); }
 
   Iterator begin() const { return Iterator(entries_.begin(), entries_.end(), this); }
   Iterator end() const { return Iterator(entries_.end(), entries_.end(), this); }
 
 private:
   const std::map<std::string, LzxEntry>& entries_;
-  std::span<char* const> names_;
-  bool use_regex_;
-  std::vector<std::regex> res_;
+  NameFilter filter_;
 };
 
 int handle_list(const FilteredEntries& entries) {
@@ -116,14 +136,67 @@ int handle_list(const FilteredEntries& entries) {
   return 0;
 }
 
+// Lists from the compact index: headers are read in place, with no per-entry allocation. Headers
+// with the same name are listed as one file, as list_archive() merges them into one entry.
+int handle_list(const ArchiveIndex& index, const NameFilter& filter) {
+  size_t total_unpack = 0;
+  size_t total_files  = 0;
+
+  std::println("Unpacked Packed   Time     Date       Attrib   Name");
+  std::println("-------- -------- -------- ---------- -------- ----");
+
+  auto by_name = index.by_name();
+  for (size_t first = 0, last = 0; first < by_name.size(); first = last) {
+    auto name = index.name(by_name[first]);
+    for (last = first + 1; last < by_name.size() && index.name(by_name[last]) == name;) ++last;
+    if (!filter.matches(name)) continue;
+
+    // The first header describes the file. Entries of a truncated merged group have no data, and
+    // a merged file's packed size is estimated from its last piece, as by LzxEntry::pack_size().
+    const auto& header = index.header(by_name[first]);
+    size_t      unpack = 0;
+    size_t      pack   = header.flags().is_merged() ? 0 : header.pack_size();
+    for (size_t position = first; position < last; ++position) {
+      uint32_t entry = by_name[position];
+      if (index.block_of(entry) == ArchiveIndex::kNoBlock) continue;
+      unpack += index.header(entry).unpack_size();
+      total_files++;
+      if (header.flags().is_merged()) pack = index.pack_size(entry);
+    }
+    total_unpack += unpack;
+
+    std::print("{:8} {:8} ", unpack, pack);
+    std::print("{0:t} {0:d} {1} ", header.datestamp(), header.attributes());
+
+    std::println("\"{}\"", name);
+    if (!index.comment(by_name[first]).empty()) {
+      std::println(": \"{}\"", index.comment(by_name[first]));
+    }
+  }
+
+  std::println("-------- -------- -------- ---------- -------- ----");
+  std::print("{:8}      n/a ", total_unpack);
+  std::println("{} file{}", total_files, ((total_files == 1) ? "" : "s"));
+  return 0;
+}
+
 int handle_view(const FilteredEntries& entries) {
   int matched_files = 0;
 
+  // Segments left to print for each block, so a block is freed after its last one.
+  std::unordered_map<LzxBlock*, size_t> users;
+  for (const auto& [name, entry] : entries) {
+    for (const auto& segment : entry.segments()) {
+      users[segment.block().get()]++;
+    }
+  }
+
   for (const auto& [name, entry] : entries) {
     std::println("-- contents of {}", name);
     for (const auto& segment : entry.segments()) {
       auto data = segment.data();
       std::print("{}", std::string_view(reinterpret_cast<const char*>(data.data()), data.size()));
+      if (--users[segment.block().get()] == 0) segment.block()->release();
     }
     matched_files++;
   }
@@ -132,58 +205,263 @@ int handle_view(const FilteredEntries& entries) {
   return 0;
 }
 
-int handle_extract(const FilteredEntries& entries) {
+// Prints the outcome of extracting or testing one file.
+void print_status(Status status) {
+  if (status == Status::Ok || status == Status::ChecksumInvalid) {
+    std::println(" crc {}", (status == Status::Ok) ? "good" : "bad");
+  } else {
+    std::println(" error: {}", format_status(status));
+  }
+}
+
+int handle_extract(const FilteredEntries& entries, size_t threads) {
+  std::vector<const LzxEntry*> selected;
   for (const auto& [name, entry] : entries) {
-    const auto& path = entry.path();
+    selected.push_back(&entry);
+  }
 
-    if (entry.unpack_size() == 0 && name.ends_with("/")) {
-      std::filesystem::create_directories(path);
-      std::print("Creating directory \"{}\"", name);
-      std::println(" crc good");
+  // A single thread is best spent decoding, with the writes overlapped on a second one.
+  std::vector<Status> results;
+  if (threads == 1) {
+    results = ExtractPipeline().extract(selected);
+  } else {
+    results = Extractor(threads).extract(selected);
+  }
+
+  int result = 0;
+  for (size_t index = 0; index < selected.size(); ++index) {
+    const auto& name   = selected[index]->name();
+    Status      status = results[index];
+
+    if (status == Status::FileCreateError) {
+      std::println("Error creating file \"{}\"", name);
+      result = 1;
       continue;
     }
 
-    if (path.has_parent_path()) {
-      std::filesystem::create_directories(path.parent_path());
+    if (selected[index]->unpack_size() == 0 && name.ends_with("/")) {
+      std::print("Creating directory \"{}\"", name);
+    } else {
+      std::print("Writing \"{}\"...", name);
     }
 
-    std::ofstream out_file(path, std::ios::binary | std::ios::out | std::ios::trunc);
-    if (!out_file) {
-      std::println("Error creating file \"{}\"", name);
-      return 1;
+    print_status(status);
+  }
+  return result;
+}
+
+// Prints how much data was checked, and how fast.
+void print_throughput(size_t files, size_t bytes, std::chrono::duration<double> elapsed) {
+  double seconds = elapsed.count();
+  std::println("Tested {} file{}, {} bytes in {:.3f} s ({:.1f} MB/s)", files, (files == 1) ? "" : "s",
+      bytes, seconds, (seconds > 0) ? static_cast<double>(bytes) / seconds / 1e6 : 0.0);
+}
+
+int handle_test(const FilteredEntries& entries, size_t threads, Status list_status) {
+  std::vector<const LzxEntry*> selected;
+  size_t                       bytes = 0;
+  for (const auto& [name, entry] : entries) {
+    selected.push_back(&entry);
+    bytes += entry.unpack_size();
+  }
+
+  auto start   = std::chrono::steady_clock::now();
+  auto results = Verifier(threads).verify(selected);
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  int result = 0;
+  for (size_t index = 0; index < selected.size(); ++index) {
+    std::print("Testing \"{}\"...", selected[index]->name());
+    print_status(results[index]);
+    if (results[index] != Status::Ok) result = 1;
+  }
+  if (list_status != Status::Ok) {
+    std::println("Error reading headers: {}", format_status(list_status));
+    result = 1;
+  }
+
+  print_throughput(selected.size(), bytes, elapsed);
+  return result;
+}
+
+// Reads archive paths, one per line, from a file or "-" for stdin.
+bool read_archive_list(const char* filename, std::vector<std::filesystem::path>& archives) {
+  std::ifstream file;
+  std::istream* in = &std::cin;
+  if (std::string_view(filename) != "-") {
+    file.open(filename);
+    if (!file) return false;
+    in = &file;
+  }
+
+  std::string line;
+  while (std::getline(*in, line)) {
+    if (!line.empty() && line.back() == '\r') line.pop_back();
+    if (!line.empty()) archives.emplace_back(line);
+  }
+  return true;
+}
+
+int handle_batch(Action action, std::span<const std::filesystem::path> archives, size_t threads) {
+  struct Failure {
+    std::string archive;
+    std::string name;
+    Status      status;
+  };
+  std::vector<Failure> failures;
+  size_t               total_files = 0;
+
+  // Archives are handled a group at a time, so the decoded blocks of finished groups are freed.
+  ThreadPool   pool(threads);
+  const size_t group_size = 4 * pool.size();
+
+  // Chosen for the whole batch, so that archives of different groups do not share one either.
+  auto destinations = Unlzx::batch_destinations(archives);
+  if (action == Action::Extract) {
+    for (size_t index = 0; index < archives.size(); ++index) {
+      if (destinations[index] != archives[index].stem()) {
+        std::println("Archive \"{}\": \"{}\" is used by another archive, extracting to \"{}\"",
+            archives[index].string(), archives[index].stem().string(), destinations[index].string());
+      }
     }
+  }
 
-    std::print("Writing \"{}\"...", name);
-    crc::Crc32 crc_calc;
-    bool       error = false;
-    for (const auto& segment : entry.segments()) {
-      auto data = segment.data();
+  for (size_t first = 0; first < archives.size(); first += group_size) {
+    size_t count  = std::min(group_size, archives.size() - first);
+    auto   opened = Unlzx::open_archives(archives.subspan(first, count), pool,
+        std::span<const std::filesystem::path>(destinations).subspan(first, count));
+    if (action == Action::Extract) Unlzx::extract_archives(opened, pool);
+
+    for (auto& archive : opened) {
+      std::string filename = archive.filename.string();
+      if (archive.status != Status::Ok) {
+        std::println("Error processing archive \"{}\": {}", filename, format_status(archive.status));
+        failures.push_back({filename, {}, archive.status});
+        continue;
+      }
+      if (archive.list_status != Status::Ok) {
+        failures.push_back({filename, {}, archive.list_status});
+      }
+      total_files += archive.entries.size();
 
-      if (segment.status() != Status::Ok) {
-        std::println(" error: {}", format_status(segment.status()));
-        error = true;
-        break;
+      if (action == Action::List) {
+        std::println("Archive \"{}\"...", filename);
+        handle_list(FilteredEntries(archive.entries, {}, false));
+        continue;
       }
 
-      crc_calc.calc(data.data(), data.size());
-      if (!out_file.write(reinterpret_cast<const char*>(data.data()), data.size())) {
-        std::println(" error writing file");
-        error = true;
-        break;
+      if (action == Action::Test) {
+        std::vector<const LzxEntry*> selected;
+        size_t                       bytes = 0;
+        for (const auto& [name, entry] : archive.entries) {
+          selected.push_back(&entry);
+          bytes += entry.unpack_size();
+        }
+
+        auto start      = std::chrono::steady_clock::now();
+        archive.results = Verifier(pool).verify(selected);
+        std::print("Archive \"{}\": ", filename);
+        print_throughput(selected.size(), bytes, std::chrono::steady_clock::now() - start);
+      }
+
+      size_t errors = 0;
+      size_t index  = 0;
+      for (const auto& [name, entry] : archive.entries) {
+        Status status = archive.results[index++];
+        if (status != Status::Ok) {
+          failures.push_back({filename, name, status});
+          errors++;
+        }
+      }
+      if (action == Action::Extract) {
+        std::println("Archive \"{}\" -> \"{}\": {} file{}, {} error{}", filename,
+            archive.destination.string(), archive.entries.size(),
+            (archive.entries.size() == 1) ? "" : "s", errors, (errors == 1) ? "" : "s");
       }
     }
+  }
 
-    if (error) continue;
+  std::println("{} archive{}, {} file{}, {} error{}", archives.size(),
+      (archives.size() == 1) ? "" : "s", total_files, (total_files == 1) ? "" : "s",
+      failures.size(), (failures.size() == 1) ? "" : "s");
+  for (const auto& failure : failures) {
+    if (failure.name.empty()) {
+      std::println("\t\"{}\": {}", failure.archive, format_status(failure.status));
+    } else {
+      std::println("\t\"{}\": \"{}\": {}", failure.archive, failure.name, format_status(failure.status));
+    }
+  }
+  return failures.empty() ? 0 : 1;
+}
 
-    std::println(" crc {}", (entry.metadata().data_crc() == crc_calc.sum()) ? "good" : "bad");
+// Writes a catalog of every entry of the archives, then reports the archives that failed.
+int handle_build_catalog(std::span<const std::filesystem::path> archives, size_t threads, const char* path) {
+  ThreadPool pool(threads);
+  Status     status = Catalog::build(archives, pool, path);
+  std::unique_ptr<Catalog> catalog;
+  if (status == Status::Ok) status = Catalog::open(path, catalog);
+  if (status != Status::Ok) {
+    std::println("Error writing catalog \"{}\": {}", path, format_status(status));
+    return 1;
   }
-  return 0;
+
+  size_t errors = 0;
+  for (size_t archive = 0; archive < catalog->archive_count(); ++archive) {
+    if (catalog->archive_status(archive) == Status::Ok) continue;
+    std::println("\t\"{}\": {}", catalog->archive(archive), format_status(catalog->archive_status(archive)));
+    errors++;
+  }
+  std::println("Catalog \"{}\": {} archive{}, {} file{}, {} error{}", path, catalog->archive_count(),
+      (catalog->archive_count() == 1) ? "" : "s", catalog->size(), (catalog->size() == 1) ? "" : "s",
+      errors, (errors == 1) ? "" : "s");
+  return errors == 0 ? 0 : 1;
+}
+
+// Looks names up in a catalog, without opening any archive.
+int handle_query(const char* path, std::span<char* const> names) {
+  std::unique_ptr<Catalog> catalog;
+  Status                   status = Catalog::open(path, catalog);
+  if (status != Status::Ok) {
+    std::println("Error reading catalog \"{}\": {}", path, format_status(status));
+    return 1;
+  }
+
+  int result = 0;
+  std::println("Unpacked CRC-32    Time     Date       Attrib   Name, Archive");
+  std::println("-------- -------- -------- ---------- -------- -------------");
+  for (const char* name : names) {
+    auto found = catalog->find(name);
+    if (found.empty()) {
+      std::println("\"{}\": not found", name);
+      result = 1;
+    }
+    for (uint32_t entry : found) {
+      const auto& header = catalog->header(entry);
+      std::print("{:8} {:08x} ", header.unpack_size(), header.data_crc());
+      std::print("{0:t} {0:d} {1} ", header.datestamp(), header.attributes());
+      std::println("\"{}\", \"{}\"", name, catalog->archive(catalog->archive_of(entry)));
+    }
+  }
+  return result;
+}
+
+// Parses the argument of -j: a positive number of threads.
+bool parse_threads(std::string_view value, size_t& threads) {
+  auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), threads);
+  return error == std::errc() && end == value.data() + value.size() && threads > 0;
 }
 
 auto main(int argc, char** argv) -> int {
   int    result = 0;
   Action action = Action::Extract;
   bool   use_regex = false;
+  bool   batch     = false;
+  bool   sidecar   = false;
+  size_t threads   = 0;
+
+  const char* archive_list = nullptr;
+  const char* catalog      = nullptr;
+  const char* query        = nullptr;
 
   int flag_idx = 1;
   while (flag_idx < argc && std::string_view(argv[flag_idx]) == "--regex") {
@@ -205,6 +483,17 @@ auto main(int argc, char** argv) -> int {
 #ifdef _WIN32
   first_file = 1;
   while (first_file < argc && argv[first_file][0] == '-') {
+    char option = argv[first_file][1];
+    if (option == 'j' || option == 'f' || option == 'c' || option == 'q') {  // -jN or -j N
+      const char* value = argv[first_file] + 2;
+      if (*value == '\0' && first_file + 1 < argc) value = argv[++first_file];
+      if (option == 'j' && !parse_threads(value, threads)) result = 1;
+      if (option == 'f') archive_list = value;
+      if (option == 'c') catalog = value;
+      if (option == 'q') query = value;
+      ++first_file;
+      continue;
+    }
     for (int j = 1; argv[first_file][j] != '\0'; ++j) {
       switch (argv[first_file][j]) {
       case 'l':  // (l)ist archive
@@ -216,6 +505,15 @@ auto main(int argc, char** argv) -> int {
       case 'v':  // (v)iew file in archive
         action = Action::View;
         break;
+      case 't':  // (t)est archive
+        action = Action::Test;
+        break;
+      case 'b':  // (b)atch of archives
+        batch = true;
+        break;
+      case 'i':  // sidecar (i)ndex
+        sidecar = true;
+        break;
       default:
         result = 1;
         break;
@@ -225,7 +523,7 @@ auto main(int argc, char** argv) -> int {
   }
 #else
   while (true) {
-    int option = getopt(argc, argv, "lxv");
+    int option = getopt(argc, argv, "lxvtbij:f:c:q:");
     if (option == -1) {
       break;
     }
@@ -240,6 +538,27 @@ auto main(int argc, char** argv) -> int {
     case 'v':  // (v)iew file in archive
       action = Action::View;
       break;
+    case 't':  // (t)est archive
+      action = Action::Test;
+      break;
+    case 'b':  // (b)atch of archives
+      batch = true;
+      break;
+    case 'i':  // sidecar (i)ndex
+      sidecar = true;
+      break;
+    case 'j':  // number of (j)obs
+      if (!parse_threads(optarg, threads)) result = 1;
+      break;
+    case 'f':  // archive list (f)ile
+      archive_list = optarg;
+      break;
+    case 'c':  // write a (c)atalog
+      catalog = optarg;
+      break;
+    case 'q':  // (q)uery a catalog
+      query = optarg;
+      break;
     case '?':  // unknown option
     default:
       result = 1;
@@ -249,15 +568,43 @@ auto main(int argc, char** argv) -> int {
   first_file = optind;
 #endif
 
-  if (result != 0 || argc - first_file < 1) {
-    std::println("Usage: unlzx [--regex] [-l][-x][-v] archive [file...]");
+  if (archive_list != nullptr) batch = true;
+  if (batch && action == Action::View) result = 1;
+  if (catalog != nullptr && query != nullptr) result = 1;
+
+  if (result != 0 || (argc - first_file < 1 && archive_list == nullptr)) {
+    std::println("Usage: unlzx [--regex] [-l][-x][-v][-t][-i] [-j N] archive [file...]");
+    std::println("       unlzx -b [-l][-x][-t] [-j N] [-f list] [archive...]");
+    std::println("       unlzx -c catalog [-j N] [-f list] [archive...]");
+    std::println("       unlzx -q catalog file...");
     std::println("\t--regex : treat file(s) as regex patterns (with -l, -v)");
     std::println("\t-l : list archive");
     std::println("\t-x : extract (default)");
     std::println("\t-v : view file(s) in archive");
+    std::println("\t-t : test file(s) in archive: decode and check CRCs without writing");
+    std::println("\t-i : with -l, keep the archive index in a sidecar file (archive.idx) to list faster next time");
+    std::println("\t-j N : extract or test with N threads (default: one per core)");
+    std::println("\t-b : batch mode: list, extract or test every archive, extracting each into a directory named after it");
+    std::println("\t-f list : read archive paths from a file, one per line, or - for stdin (implies -b)");
+    std::println("\t-c catalog : write a catalog of the files of every archive, for -q");
+    std::println("\t-q catalog : find file(s) in a catalog: print their size, CRC, date and archive");
     return 2;
   }
 
+  if (query != nullptr) {
+    return handle_query(query, std::span<char* const>(argv + first_file, static_cast<size_t>(argc - first_file)));
+  }
+
+  if (batch || catalog != nullptr) {
+    std::vector<std::filesystem::path> archives(argv + first_file, argv + argc);
+    if (archive_list != nullptr && !read_archive_list(archive_list, archives)) {
+      std::println("Error reading archive list \"{}\"", archive_list);
+      return 1;
+    }
+    if (catalog != nullptr) return handle_build_catalog(archives, threads, catalog);
+    return handle_batch(action, archives, threads);
+  }
+
   {
     std::println("Archive \"{}\"...", argv[first_file]);
     Unlzx  unlzx;
@@ -267,15 +614,27 @@ auto main(int argc, char** argv) -> int {
       return 1;
     }
 
-    auto map_entries = unlzx.list_archive();
-    FilteredEntries entries(map_entries, std::span<char* const>(argv + first_file + 1, static_cast<size_t>(argc - (first_file + 1))), use_regex);
-
-    switch (action) {
-      case Action::List: return handle_list(entries);
-      case Action::View: return handle_view(entries);
-      case Action::Extract: return handle_extract(entries);
+    std::span<char* const> names(argv + first_file + 1, static_cast<size_t>(argc - (first_file + 1)));
+    if (action == Action::List) {
+      std::unique_ptr<ArchiveIndex> index;
+      Status                        index_status =
+          sidecar ? unlzx.index_archive(index, std::filesystem::path(argv[first_file]) += ".idx")
+                  : unlzx.index_archive(index);
+
+      // Entries read before an error are still listed, as by handle_test().
+      int result = index ? handle_list(*index, NameFilter(names, use_regex)) : 1;
+      if (index_status != Status::Ok) {
+        std::println("Error reading headers: {}", format_status(index_status));
+        result = 1;
+      }
+      return result;
     }
 
+    auto map_entries = unlzx.list_archive();
+    FilteredEntries entries(map_entries, names, use_regex);
+
+    if (action == Action::View) return handle_view(entries);
+    if (action == Action::Extract) return handle_extract(entries, threads);
+    return handle_test(entries, threads, unlzx.list_status());
   }
-  return 0;
 }
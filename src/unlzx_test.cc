@@ -1,8 +1,54 @@
 #include "unlzx.hh"
 
 #include "gtest/gtest.h"
+#include "test_archive.hh"
+
+namespace {
+
+class UnlzxTest : public ArchiveTest {};
+
+TEST_F(UnlzxTest, ExtractsBatchOfArchives) {
+  std::vector<std::filesystem::path> filenames;
+  std::vector<TestArchive::File>     files;
+  for (size_t index = 0; index < 5; ++index) {
+    TestArchive archive;
+    files.push_back({"file", pattern(1000 + index, static_cast<uint8_t>(index))});
+    archive.add_block({files.back(), {"dir/other", pattern(10, 0)}});
+
+    filenames.push_back(root_ / ("archive" + std::to_string(index) + ".lzx"));
+    std::ofstream out(filenames.back(), std::ios::binary);
+    out.write(reinterpret_cast<const char*>(archive.bytes().data()), static_cast<std::streamsize>(archive.bytes().size()));
+  }
+  filenames.push_back(root_ / "missing.lzx");
+
+  ThreadPool pool(2);
+  auto       archives = Unlzx::open_archives(filenames, pool);
+  ASSERT_EQ(archives.size(), filenames.size());
+  EXPECT_NE(archives.back().status, Status::Ok);
+
+  Unlzx::extract_archives(archives, pool);
+  for (size_t index = 0; index < files.size(); ++index) {
+    ASSERT_EQ(archives[index].status, Status::Ok);
+    EXPECT_EQ(archives[index].destination, "archive" + std::to_string(index));
+    ASSERT_EQ(archives[index].results.size(), 2U);
+    for (Status status : archives[index].results) EXPECT_EQ(status, Status::Ok);
+    EXPECT_EQ(read_file(archives[index].destination / "file"), files[index].data);
+    EXPECT_EQ(read_file(archives[index].destination / "dir/other"), pattern(10, 0));
+  }
+  EXPECT_TRUE(archives.back().results.empty());
+}
+
+TEST_F(UnlzxTest, GivesEachArchiveItsOwnDestination) {
+  std::vector<std::filesystem::path> filenames = {
+      "a/x.lzx", "b/x.lzx", "x.2.lzx", "c/x.lzx", "y.lzx", "y"};
+  auto destinations = Unlzx::batch_destinations(filenames);
+  std::vector<std::filesystem::path> expected = {"x", "x.3", "x.2", "x.4", "y", "y.2"};
+  EXPECT_EQ(destinations, expected);
+}
+
+}  // namespace
 
 int main(int argc, char** argv) {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
-}
\ No newline at end of file
+}
@@ -0,0 +1,47 @@
+#include "verifier.hh"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "crc.hh"
+
+Verifier::Verifier(size_t threads)
+    : own_pool_(std::make_unique<ThreadPool>(threads)), pool_(*own_pool_) {}
+
+std::vector<Status> Verifier::verify(std::span<const LzxEntry* const> entries) {
+  std::unordered_set<LzxBlock*> unique;
+  for (const auto* entry : entries) {
+    for (const auto& segment : entry->segments()) {
+      unique.insert(segment.block().get());
+    }
+  }
+
+  std::vector<LzxBlock*> blocks(unique.begin(), unique.end());
+  std::sort(blocks.begin(), blocks.end(), [](const LzxBlock* left, const LzxBlock* right) {
+    return left->total_unpacked_size() > right->total_unpacked_size();
+  });
+  for (LzxBlock* block : blocks) {
+    pool_.submit([block]() { block->checksum(); });
+  }
+  pool_.wait();
+
+  std::vector<Status> results;
+  results.reserve(entries.size());
+  for (const auto* entry : entries) {
+    Status     status = Status::Ok;
+    crc::Crc32 crc;
+    for (const auto& segment : entry->segments()) {
+      auto segment_crc = segment.crc();
+      if (!segment_crc) {
+        status = segment.status();
+        break;
+      }
+      crc.combine(*segment_crc, segment.decompressed_length());
+    }
+    if (status == Status::Ok && crc.sum() != entry->metadata().data_crc()) {
+      status = Status::ChecksumInvalid;
+    }
+    results.push_back(status);
+  }
+  return results;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+#include "error.hh"
+#include "lzx_entry.hh"
+#include "thread_pool.hh"
+
+/**
+ * @brief Checks the data CRC-32 of entries without writing anything.
+ *
+ * Blocks are checksummed concurrently, largest first, with `LzxBlock::checksum()`: each is
+ * streamed through the decoder's window and nothing decompressed is kept, so memory use depends on
+ * the number of threads and not on the size of the archive.
+ */
+class Verifier {
+ public:
+  /**
+   * @brief Constructs a new Verifier with its own thread pool.
+   * @param threads Number of worker threads; 0 for one per hardware thread.
+   */
+  explicit Verifier(size_t threads = 0);
+
+  /**
+   * @brief Constructs a new Verifier running on a shared thread pool.
+   *
+   * `verify()` waits for the pool to be idle, so it must not run concurrently with other users of
+   * the pool.
+   *
+   * @param pool The pool to run on; must outlive the Verifier.
+   */
+  explicit Verifier(ThreadPool& pool) : pool_(pool) {}
+
+  /**
+   * @brief Decodes the blocks of the entries and checks their data CRC-32.
+   * @param entries The entries to check.
+   * @return The status of each entry, in the same order: Status::Ok, Status::ChecksumInvalid if
+   *         the CRC-32 does not match, or the error that stopped decoding its data.
+   */
+  std::vector<Status> verify(std::span<const LzxEntry* const> entries);
+
+ private:
+  std::unique_ptr<ThreadPool> own_pool_;
+  ThreadPool&                 pool_;
+};
@@ -0,0 +1,52 @@
+#include "verifier.hh"
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <vector>
+
+#include "test_archive.hh"
+#include "test_encoder.hh"
+
+namespace {
+
+class VerifierTest : public ArchiveTest {};
+
+TEST_F(VerifierTest, ChecksStoredAndCompressedBlocks) {
+  std::vector<uint8_t> expected;
+  auto                 packed = test_encoder::encode_random(400000, 60000, expected, 3);
+
+  TestArchive archive;
+  archive.add_block({{"stored", pattern(5000, 1)}});
+  archive.add_block({{"a", std::vector<uint8_t>(expected.begin(), expected.begin() + 300000)},
+                        {"b", std::vector<uint8_t>(expected.begin() + 300000, expected.end())}},
+      packed);
+  auto entries = open(archive);
+  EXPECT_EQ(unlzx_.list_status(), Status::Ok);
+
+  std::vector<const LzxEntry*> selected;
+  for (const auto& [name, entry] : entries) selected.push_back(&entry);
+
+  for (Status status : Verifier(2).verify(selected)) EXPECT_EQ(status, Status::Ok);
+  EXPECT_TRUE(std::filesystem::is_empty("."));
+}
+
+TEST_F(VerifierTest, ReportsBadCrcAndDamagedHeader) {
+  TestArchive archive;
+  archive.add_block({{"bad", pattern(100, 5)}});
+  archive.add_block({{"good", pattern(100, 6)}});
+  auto bytes = archive.bytes();
+  bytes[10 + 31 + 3] ^= 0xFF;  // Data of "bad".
+  bytes.push_back(0);          // Truncated header.
+
+  auto entries = open(bytes);
+  EXPECT_NE(unlzx_.list_status(), Status::Ok);
+  ASSERT_EQ(entries.size(), 2U);
+
+  const LzxEntry* selected[] = {&entries.at("bad"), &entries.at("good")};
+  auto            results    = Verifier(1).verify(selected);
+  EXPECT_EQ(results[0], Status::ChecksumInvalid);
+  EXPECT_EQ(results[1], Status::Ok);
+}
+
+}  // namespace